@@ -0,0 +1,81 @@
+#ifndef RBT_AGGREGATE_HPP_
+#define RBT_AGGREGATE_HPP_
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace rbt {
+
+/*
+* 常用的子树聚合，作为set/map的Monoid模板参数，由reduce(lo, hi)查询
+* Projection从元素(set为key，map为pair)中取出参与聚合的量
+*/
+
+/*
+* 取map元素的mapped值
+*/
+struct SelectMapped {
+    template <class Pair>
+    constexpr const auto& operator()(const Pair& value) const noexcept {
+        return value.second;
+    }
+};
+
+template <class T, class Projection = std::identity>
+struct SumMonoid {
+    using Aggregate = T;
+
+    static constexpr Aggregate Identity() {
+        return T{};
+    }
+
+    template <class Value>
+    static constexpr Aggregate FromValue(const Value& value) {
+        return static_cast<T>(Projection{}(value));
+    }
+
+    static constexpr Aggregate Combine(const Aggregate& a, const Aggregate& b) {
+        return a + b;
+    }
+};
+
+template <class T, class Projection = std::identity>
+struct MinMonoid {
+    using Aggregate = T;
+
+    static constexpr Aggregate Identity() {
+        return std::numeric_limits<T>::max();
+    }
+
+    template <class Value>
+    static constexpr Aggregate FromValue(const Value& value) {
+        return static_cast<T>(Projection{}(value));
+    }
+
+    static constexpr Aggregate Combine(const Aggregate& a, const Aggregate& b) {
+        return std::min(a, b);
+    }
+};
+
+template <class T, class Projection = std::identity>
+struct MaxMonoid {
+    using Aggregate = T;
+
+    static constexpr Aggregate Identity() {
+        return std::numeric_limits<T>::lowest();
+    }
+
+    template <class Value>
+    static constexpr Aggregate FromValue(const Value& value) {
+        return static_cast<T>(Projection{}(value));
+    }
+
+    static constexpr Aggregate Combine(const Aggregate& a, const Aggregate& b) {
+        return std::max(a, b);
+    }
+};
+
+} // namespace rbt
+
+#endif // RBT_AGGREGATE_HPP_
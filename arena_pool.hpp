@@ -0,0 +1,161 @@
+#ifndef RBT_ARENA_POOL_HPP_
+#define RBT_ARENA_POOL_HPP_
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include <fpoo/memory_pool.hpp>
+
+namespace rbt {
+
+template <class T>
+class ArenaPool;
+
+/*
+* 由外部持有、供多棵树共享的节点池
+* 树的节点地址仍是该池内的32位下标，同一arena上的树拼接/拆分时只需重新链接节点
+* 不是线程安全的，树析构前arena必须一直存在
+*/
+template <class T>
+class NodeArena {
+public:
+    NodeArena() = default;
+
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    /*
+    * 一次性释放所有块，不析构元素
+    * 之后其上原有的树只能析构或clear，此时不会再访问节点
+    */
+    void reset() noexcept {
+        pool_ = fpoo::CompactMemoryPool<T>{};
+        ++generation_;
+    }
+
+    uint64_t generation() const noexcept {
+        return generation_;
+    }
+
+private:
+    friend class ArenaPool<T>;
+
+    fpoo::CompactMemoryPool<T> pool_;
+    uint64_t generation_ = 0;
+};
+
+/*
+* 将节点分配在NodeArena上的内存池，接口与fpoo::CompactMemoryPool一致
+* 未绑定arena时在第一次分配时创建私有的arena，行为与CompactMemoryPool相同
+*/
+template <class T>
+class ArenaPool {
+public:
+    static constexpr bool kShared = true;
+
+    using arena_type = NodeArena<T>;
+    using value_type = T;
+    using size_type = typename fpoo::CompactMemoryPool<T>::size_type;
+    using difference_type = typename fpoo::CompactMemoryPool<T>::difference_type;
+
+    ArenaPool() = default;
+
+    explicit ArenaPool(arena_type* arena) noexcept :
+        arena_(arena), generation_(arena ? arena->generation() : 0) {
+    }
+
+    ArenaPool(const ArenaPool&) = delete;
+    ArenaPool& operator=(const ArenaPool&) = delete;
+
+    /*
+    * 共享的arena在移动后仍绑定在原对象上，私有的arena随之转移
+    */
+    ArenaPool(ArenaPool&& right) noexcept :
+        owned_(std::move(right.owned_)), arena_(right.arena_), generation_(right.generation_) {
+        if (owned_) {
+            right.arena_ = nullptr;
+        }
+    }
+
+    ArenaPool& operator=(ArenaPool&& right) noexcept {
+        if (this != &right) {
+            owned_ = std::move(right.owned_);
+            arena_ = right.arena_;
+            generation_ = right.generation_;
+            if (owned_) {
+                right.arena_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    /*
+    * 是否绑定在外部的arena上
+    */
+    bool shared() const noexcept {
+        return arena_ && !owned_;
+    }
+
+    arena_type* arena() const noexcept {
+        return shared() ? arena_ : nullptr;
+    }
+
+    /*
+    * 绑定(或上次reset)之后arena是否被重置过，此时已分配的节点都不存在了
+    */
+    bool expired() const noexcept {
+        return arena_ && arena_->generation() != generation_;
+    }
+
+    /*
+    * 私有的arena直接释放，共享的arena只是不再引用其中的节点
+    */
+    void reset() noexcept {
+        if (owned_) {
+            owned_.reset();
+            arena_ = nullptr;
+        }
+        else if (arena_) {
+            generation_ = arena_->generation();
+        }
+    }
+
+    /*
+    * arena重置后须先reset()再分配，否则会把新节点与已不存在的节点混用
+    */
+    size_type allocate() {
+        if (!arena_) {
+            owned_ = std::make_unique<arena_type>();
+            arena_ = owned_.get();
+            generation_ = arena_->generation();
+        }
+        assert(!expired());
+        return arena_->pool_.allocate();
+    }
+
+    void deallocate(size_type addr) noexcept {
+        assert(!expired());
+        arena_->pool_.deallocate(addr);
+    }
+
+    T* reference(size_type addr) const noexcept {
+        return arena_ ? arena_->pool_.reference(addr) : nullptr;
+    }
+
+    void dereference(T* node) const noexcept {
+        if (arena_) {
+            arena_->pool_.dereference(node);
+        }
+    }
+
+private:
+    std::unique_ptr<arena_type> owned_;
+    arena_type* arena_ = nullptr;
+    uint64_t generation_ = 0;
+};
+
+} // namespace rbt
+
+#endif // RBT_ARENA_POOL_HPP_
@@ -0,0 +1,1442 @@
+#ifndef RBT_B_TREE_HPP_
+#define RBT_B_TREE_HPP_
+
+#include <utility>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <memory>
+#include <iterator>
+#include <compare>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <initializer_list>
+#include <limits>
+#include <type_traits>
+#include <concepts>
+
+#include <fpoo/memory_pool.hpp>
+
+#include <rbt/compare.hpp>
+
+namespace rbt {
+
+/*
+* 叶子地址 + 槽位，不携带路径，只有16字节
+* 叶子之间双向链接，++/--至多跨到相邻的叶子
+*/
+template <class BTreeT>
+class BTreeConstIterator {
+public:
+    using iterator_category = std::bidirectional_iterator_tag;
+
+    using NodeAddress = typename BTreeT::NodeAddress;
+
+    using value_type = typename BTreeT::value_type;
+    using difference_type = typename BTreeT::difference_type;
+    using pointer = typename BTreeT::const_pointer;
+    using reference = const value_type&;
+
+    BTreeConstIterator() noexcept = default;
+
+    BTreeConstIterator(const BTreeT* b_tree, NodeAddress leaf_address, uint32_t slot) noexcept :
+        b_tree_{ b_tree },
+        leaf_address_{ leaf_address },
+        slot_{ slot } {
+
+    }
+
+    [[nodiscard]] reference operator*() const noexcept {
+        return b_tree_->GetValue(leaf_address_, slot_);
+    }
+
+    [[nodiscard]] pointer operator->() const noexcept {
+        return std::pointer_traits<pointer>::pointer_to(**this);
+    }
+
+    BTreeConstIterator& operator++() noexcept {
+        b_tree_->Next(leaf_address_, slot_);
+        return *this;
+    }
+
+    BTreeConstIterator operator++(int) noexcept {
+        BTreeConstIterator tmp = *this;
+        ++*this;
+        return tmp;
+    }
+
+    BTreeConstIterator& operator--() noexcept {
+        b_tree_->Prev(leaf_address_, slot_);
+        return *this;
+    }
+
+    BTreeConstIterator operator--(int) noexcept {
+        BTreeConstIterator tmp = *this;
+        --*this;
+        return tmp;
+    }
+
+    [[nodiscard]] bool operator==(const BTreeConstIterator& right) const noexcept {
+        return leaf_address_ == right.leaf_address_ && slot_ == right.slot_;
+    }
+
+protected:
+    friend BTreeT;
+
+    const BTreeT* b_tree_ = nullptr;
+    NodeAddress leaf_address_ = BTreeT::kInvalidAddress;
+    uint32_t slot_ = 0;
+};
+
+template <class BTreeT>
+class BTreeIterator : public BTreeConstIterator<BTreeT> {
+public:
+    using Base = BTreeConstIterator<BTreeT>;
+    using iterator_category = std::bidirectional_iterator_tag;
+
+    using value_type = typename BTreeT::value_type;
+    using difference_type = typename BTreeT::difference_type;
+    using pointer = typename BTreeT::pointer;
+    using reference = value_type&;
+
+    using Base::Base;
+
+    [[nodiscard]] reference operator*() const noexcept {
+        return const_cast<reference>(Base::operator*());
+    }
+
+    [[nodiscard]] pointer operator->() const noexcept {
+        return std::pointer_traits<pointer>::pointer_to(**this);
+    }
+
+    BTreeIterator& operator++() noexcept {
+        Base::operator++();
+        return *this;
+    }
+
+    BTreeIterator operator++(int) noexcept {
+        BTreeIterator tmp = *this;
+        Base::operator++();
+        return tmp;
+    }
+
+    BTreeIterator& operator--() noexcept {
+        Base::operator--();
+        return *this;
+    }
+
+    BTreeIterator operator--(int) noexcept {
+        BTreeIterator tmp = *this;
+        Base::operator--();
+        return tmp;
+    }
+};
+
+/*
+* 与RbTree共用SetTraits/MapTraits的B+树，作为set/map的另一种引擎(见btree_set/btree_map)
+* 节点约占4条缓存行，元素只存放在叶子中，内部节点只存放分隔key与孩子地址
+* 节点内顺序查找，叶子按顺序双向链接，遍历时不需要回溯
+* 节点同样分配在Traits::Pool中并以32位地址相互引用
+*
+* 插入或删除会在节点内移动元素，并可能分裂/合并节点，因此会使所有迭代器失效
+* 需要迭代器在修改后仍然有效，或需要顺序统计/聚合/持久化时应使用RbTree
+*/
+template <class Traits>
+class BTree {
+private:
+    using Key = typename Traits::Key;
+    using Value = typename Traits::Value;
+    using Element = typename Traits::Element;
+    using ThreeWayCompare = typename Traits::ThreeWayCompare;
+
+    static_assert(!Traits::kMulti, "BTree does not support duplicate keys");
+    static_assert(!Traits::kOrderStatistic && std::is_void_v<typename Traits::Monoid>, "BTree does not support order statistics or aggregates");
+    /* 分裂与合并需要移动元素，分隔key是叶子中key的副本 */
+    static_assert(std::is_move_constructible_v<Element> && std::is_copy_constructible_v<Key>);
+
+    friend class BTreeConstIterator<BTree>;
+
+public:
+    using NodeAddress = typename Traits::NodeAddress;
+    static_assert(std::is_same_v<NodeAddress, uint16_t> || std::is_same_v<NodeAddress, uint32_t> || std::is_same_v<NodeAddress, uint64_t>,
+        "NodeAddress must be uint16_t, uint32_t or uint64_t");
+
+    static constexpr NodeAddress kInvalidAddress = std::numeric_limits<NodeAddress>::max() >> 1;
+    static constexpr NodeAddress kMaxAddress = kInvalidAddress - 1;
+
+private:
+    /* 节点的目标大小，4条缓存行，节点内顺序查找一次扫过的key都在其中 */
+    static constexpr size_t kNodeBytes = 256;
+    /* 叶子的前后链接、元素个数与叶子标记 */
+    static constexpr size_t kHeaderBytes = 2 * sizeof(NodeAddress) + sizeof(uint32_t);
+
+    static constexpr uint32_t kLeafCapacity = static_cast<uint32_t>(std::max<size_t>(4, (kNodeBytes - kHeaderBytes) / sizeof(Element)));
+    static constexpr uint32_t kInnerCapacity = static_cast<uint32_t>(std::max<size_t>(4, (kNodeBytes - kHeaderBytes - sizeof(NodeAddress)) / (sizeof(Key) + sizeof(NodeAddress))));
+    /* 根以外的节点至少保持半满，分裂出的两半都满足该下限 */
+    static constexpr uint32_t kLeafMin = kLeafCapacity / 2;
+    static constexpr uint32_t kInnerMin = (kInnerCapacity - 1) / 2;
+    /* 根以外的内部节点至少有2个孩子，高度不超过地址位数 */
+    static constexpr size_t kMaxDepth = sizeof(NodeAddress) * 8;
+
+    /*
+    * 叶子与内部节点共用同一类型，从而共用一个内存池
+    * 元素与key只在[0, count)中构造，其余槽位是未初始化的存储
+    */
+    class Node {
+    public:
+        explicit Node(bool leaf) noexcept : prev_(kInvalidAddress), next_(kInvalidAddress), count_(0), leaf_(leaf) {
+        }
+
+        bool IsLeaf() const noexcept {
+            return leaf_;
+        }
+
+        uint32_t GetCount() const noexcept {
+            return count_;
+        }
+
+        void SetCount(uint32_t count) noexcept {
+            count_ = static_cast<uint16_t>(count);
+        }
+
+        NodeAddress GetPrev() const noexcept {
+            return prev_;
+        }
+
+        NodeAddress GetNext() const noexcept {
+            return next_;
+        }
+
+        void SetPrev(NodeAddress prev) noexcept {
+            prev_ = prev;
+        }
+
+        void SetNext(NodeAddress next) noexcept {
+            next_ = next;
+        }
+
+        Element* GetElements() noexcept {
+            return std::launder(reinterpret_cast<Element*>(leaf_data_.elements));
+        }
+
+        Key* GetKeys() noexcept {
+            return std::launder(reinterpret_cast<Key*>(inner_data_.keys));
+        }
+
+        NodeAddress* GetChildren() noexcept {
+            return inner_data_.children;
+        }
+
+        const Key& GetKey(uint32_t slot) noexcept {
+            return Traits::GetKey(GetElements()[slot]);
+        }
+
+    private:
+        struct LeafData {
+            alignas(Element) unsigned char elements[kLeafCapacity * sizeof(Element)];
+        };
+        struct InnerData {
+            alignas(Key) unsigned char keys[kInnerCapacity * sizeof(Key)];
+            NodeAddress children[kInnerCapacity + 1];
+        };
+
+        NodeAddress prev_;
+        NodeAddress next_;
+        uint16_t count_;
+        bool leaf_;
+        union {
+            LeafData leaf_data_;
+            InnerData inner_data_;
+        };
+    };
+    using AllocatorType = typename Traits::template Pool<Node>;
+
+    /* 根与大小只保存在树对象中，不能映射到文件 */
+    static_assert(!requires { AllocatorType::kMapped; }, "BTree does not support MappedPool");
+
+    /*
+    * 从根到叶子经过的内部节点，以及在每个节点中选择的孩子下标
+    */
+    class Path {
+    public:
+        void push_back(NodeAddress node_id, uint32_t index) noexcept {
+            nodes_[size_] = node_id;
+            indexes_[size_] = index;
+            ++size_;
+        }
+
+        void pop_back() noexcept {
+            --size_;
+        }
+
+        bool empty() const noexcept {
+            return size_ == 0;
+        }
+
+        NodeAddress back_node() const noexcept {
+            return nodes_[size_ - 1];
+        }
+
+        uint32_t back_index() const noexcept {
+            return indexes_[size_ - 1];
+        }
+
+    private:
+        std::array<NodeAddress, kMaxDepth> nodes_;
+        std::array<uint32_t, kMaxDepth> indexes_;
+        uint32_t size_ = 0;
+    };
+
+public:
+    using key_type = Key;
+    using value_type = Value;
+    /* 每个叶子容纳多个元素，元素数不受节点地址宽度限制 */
+    using size_type = uint64_t;
+    using difference_type = int64_t;
+
+    using key_compare = typename Traits::KeyCompare;
+    using value_compare = typename Traits::ValueCompare;
+
+    using allocator_type = AllocatorType;
+
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+
+    using iterator = BTreeIterator<BTree<Traits>>;
+    using const_iterator = BTreeConstIterator<BTree<Traits>>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+public:
+    BTree() {
+    }
+
+    template <class InputIt>
+    BTree(InputIt first, InputIt last) {
+        std::vector<value_type> values(first, last);
+        /* value_type未必可赋值(如map的pair<const Key, T>)，因此对指针排序 */
+        std::vector<value_type*> sorted(values.size());
+        std::transform(values.begin(), values.end(), sorted.begin(), [](value_type& value) { return &value; });
+        auto less = [](const value_type* a, const value_type* b) {
+            return value_compare{}(*a, *b);
+        };
+        if (!std::is_sorted(sorted.begin(), sorted.end(), less)) {
+            /* 稳定排序，去重时保留先出现的元素，与逐个insert的语义一致 */
+            std::stable_sort(sorted.begin(), sorted.end(), less);
+        }
+        auto new_end = std::unique(sorted.begin(), sorted.end(), [&](const value_type* a, const value_type* b) {
+            return !less(a, b);
+        });
+        BuildSorted(static_cast<size_type>(new_end - sorted.begin()), [&](size_type i) -> value_type&& {
+            return std::move(*sorted[i]);
+        });
+    }
+
+    BTree(std::initializer_list<value_type> init) : BTree(init.begin(), init.end()) {
+    }
+
+    /*
+    * 按叶子链取出元素后自底向上构建，O(n)
+    */
+    BTree(const BTree& right) {
+        std::vector<const value_type*> values;
+        values.reserve(right.size_);
+        for (auto& value : right) {
+            values.push_back(&value);
+        }
+        BuildSorted(static_cast<size_type>(values.size()), [&](size_type i) -> const value_type& {
+            return *values[i];
+        });
+    }
+
+    BTree(BTree&& right) noexcept :
+        allocator_(std::move(right.allocator_)), root_(right.root_), head_(right.head_), tail_(right.tail_), size_(right.size_) {
+        right.allocator_ = AllocatorType{};
+        right.root_ = kInvalidAddress;
+        right.head_ = kInvalidAddress;
+        right.tail_ = kInvalidAddress;
+        right.size_ = 0;
+    }
+
+    ~BTree() noexcept {
+        DestroyElements();
+    }
+
+    BTree& operator=(const BTree& right) {
+        if (this != &right) {
+            BTree copy{ right };
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    BTree& operator=(BTree&& right) noexcept {
+        if (this != &right) {
+            DestroyElements();
+            allocator_ = std::move(right.allocator_);
+            root_ = right.root_;
+            head_ = right.head_;
+            tail_ = right.tail_;
+            size_ = right.size_;
+            right.allocator_ = AllocatorType{};
+            right.root_ = kInvalidAddress;
+            right.head_ = kInvalidAddress;
+            right.tail_ = kInvalidAddress;
+            right.size_ = 0;
+        }
+        return *this;
+    }
+
+public:
+    /*
+    * 析构元素与分隔key后直接丢弃整个内存池
+    */
+    void clear() noexcept {
+        DestroyElements();
+        allocator_ = AllocatorType{};
+        root_ = kInvalidAddress;
+        head_ = kInvalidAddress;
+        tail_ = kInvalidAddress;
+        size_ = 0;
+    }
+
+    void swap(BTree& right) noexcept {
+        std::swap(allocator_, right.allocator_);
+        std::swap(root_, right.root_);
+        std::swap(head_, right.head_);
+        std::swap(tail_, right.tail_);
+        std::swap(size_, right.size_);
+    }
+
+    [[nodiscard]] size_type size() const noexcept {
+        return size_;
+    }
+
+    /*
+    * 每个叶子至少半满时可容纳的元素数，超出size_type时取其上限
+    */
+    [[nodiscard]] size_type max_size() const noexcept {
+        constexpr size_type kLimit = std::numeric_limits<size_type>::max();
+        return kMaxAddress > kLimit / kLeafMin ? kLimit : static_cast<size_type>(kMaxAddress) * kLeafMin;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return root_ == kInvalidAddress;
+    }
+
+    key_compare key_comp() const {
+        return key_compare{};
+    }
+
+    value_compare value_comp() const {
+        return value_compare{};
+    }
+
+
+    iterator find(const Key& key) {
+        auto [leaf_id, slot] = Find(key);
+        return iterator{ this, leaf_id, slot };
+    }
+
+    const_iterator find(const Key& key) const {
+        auto [leaf_id, slot] = Find(key);
+        return const_iterator{ this, leaf_id, slot };
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    iterator find(const K& x) {
+        auto [leaf_id, slot] = Find(x);
+        return iterator{ this, leaf_id, slot };
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    const_iterator find(const K& x) const {
+        auto [leaf_id, slot] = Find(x);
+        return const_iterator{ this, leaf_id, slot };
+    }
+
+    template <class K> bool contains(const K& x) const {
+        return find(x) != end();
+    }
+
+    size_type count(const Key& key) const {
+        return contains(key) ? 1 : 0;
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    size_type count(const K& x) const {
+        return contains(x) ? 1 : 0;
+    }
+
+    iterator lower_bound(const Key& key) {
+        auto [leaf_id, slot] = Bound<false>(key);
+        return iterator{ this, leaf_id, slot };
+    }
+
+    const_iterator lower_bound(const Key& key) const {
+        auto [leaf_id, slot] = Bound<false>(key);
+        return const_iterator{ this, leaf_id, slot };
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    iterator lower_bound(const K& x) {
+        auto [leaf_id, slot] = Bound<false>(x);
+        return iterator{ this, leaf_id, slot };
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    const_iterator lower_bound(const K& x) const {
+        auto [leaf_id, slot] = Bound<false>(x);
+        return const_iterator{ this, leaf_id, slot };
+    }
+
+    iterator upper_bound(const Key& key) {
+        auto [leaf_id, slot] = Bound<true>(key);
+        return iterator{ this, leaf_id, slot };
+    }
+
+    const_iterator upper_bound(const Key& key) const {
+        auto [leaf_id, slot] = Bound<true>(key);
+        return const_iterator{ this, leaf_id, slot };
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    iterator upper_bound(const K& x) {
+        auto [leaf_id, slot] = Bound<true>(x);
+        return iterator{ this, leaf_id, slot };
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    const_iterator upper_bound(const K& x) const {
+        auto [leaf_id, slot] = Bound<true>(x);
+        return const_iterator{ this, leaf_id, slot };
+    }
+
+    std::pair<iterator, iterator> equal_range(const Key& key) {
+        auto first = lower_bound(key);
+        return std::pair{ first, EqualRangeEnd(first, key) };
+    }
+
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
+        auto first = lower_bound(key);
+        return std::pair{ first, EqualRangeEnd(first, key) };
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    std::pair<iterator, iterator> equal_range(const K& x) {
+        auto first = lower_bound(x);
+        return std::pair{ first, EqualRangeEnd(first, x) };
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    std::pair<const_iterator, const_iterator> equal_range(const K& x) const {
+        auto first = lower_bound(x);
+        return std::pair{ first, EqualRangeEnd(first, x) };
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return EmplaceKey(Traits::GetKey(value), value);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& value) {
+        return EmplaceKey(Traits::GetKey(value), std::move(value));
+    }
+
+    template <class InputIt>
+    void insert(InputIt first, InputIt last) {
+        for (; first != last; ++first) {
+            emplace(*first);
+        }
+    }
+
+    void insert(std::initializer_list<value_type> init) {
+        insert(init.begin(), init.end());
+    }
+
+    /*
+    * 参数能直接取得key时(见Traits::ExtractKey)先查找，元素只在叶子中原位构造一次
+    * 否则先在栈上构造元素，再按其key插入
+    */
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        if constexpr (requires { Traits::ExtractKey(args...); }) {
+            return EmplaceKey(Traits::ExtractKey(args...), std::forward<Args>(args)...);
+        }
+        else {
+            Element element(std::forward<Args>(args)...);
+            const Key& key = Traits::GetKey(element);
+            return EmplaceKey(key, std::move(element));
+        }
+    }
+
+    /*
+    * 叶子内的位置随插入变化，hint没有意义，只为与RbTree接口一致
+    */
+    template <class... Args>
+    iterator emplace_hint(const_iterator, Args&&... args) {
+        return emplace(std::forward<Args>(args)...).first;
+    }
+
+    size_type erase(const key_type& key) {
+        Path path;
+        auto [leaf_id, slot] = Descend<false>(path, key);
+        if (leaf_id == kInvalidAddress) {
+            return 0;
+        }
+        Node* leaf = allocator_.reference(leaf_id);
+        if (slot == leaf->GetCount() || ThreeWayCompare::Compare(leaf->GetKey(slot), key) != 0) {
+            return 0;
+        }
+        EraseAt(path, leaf_id, slot);
+        return 1;
+    }
+
+    /*
+    * 按pos的key重新下降以取得路径，返回删除后pos的后继
+    */
+    iterator erase(const_iterator pos) {
+        assert(pos.leaf_address_ != kInvalidAddress);
+        Path path;
+        Descend<false>(path, Traits::GetKey(GetElement(pos.leaf_address_, pos.slot_)));
+        return EraseAt(path, pos.leaf_address_, pos.slot_);
+    }
+
+    iterator erase(iterator pos) {
+        return erase(static_cast<const_iterator&>(pos));
+    }
+
+    /*
+    * 删除会移动元素使last失效，因此先求出个数再逐个删除
+    * 删除全部元素时退化为clear
+    */
+    iterator erase(const_iterator first, const_iterator last) {
+        if (first == cbegin() && last == cend()) {
+            clear();
+            return end();
+        }
+        auto count = std::distance(first, last);
+        iterator pos{ this, first.leaf_address_, first.slot_ };
+        for (; count > 0; --count) {
+            pos = erase(pos);
+        }
+        return pos;
+    }
+
+    /*
+    * iterator
+    */
+    iterator begin() noexcept {
+        return iterator{ this, head_, 0 };
+    }
+
+    const_iterator begin() const noexcept {
+        return const_iterator{ this, head_, 0 };
+    }
+
+    iterator end() noexcept {
+        return iterator{ this, kInvalidAddress, 0 };
+    }
+
+    const_iterator end() const noexcept {
+        return const_iterator{ this, kInvalidAddress, 0 };
+    }
+
+    [[nodiscard]] reverse_iterator rbegin() noexcept {
+        return reverse_iterator(end());
+    }
+
+    [[nodiscard]] const_reverse_iterator rbegin() const noexcept {
+        return const_reverse_iterator(end());
+    }
+
+    [[nodiscard]] reverse_iterator rend() noexcept {
+        return reverse_iterator(begin());
+    }
+
+    [[nodiscard]] const_reverse_iterator rend() const noexcept {
+        return const_reverse_iterator(begin());
+    }
+
+    [[nodiscard]] const_iterator cbegin() const noexcept {
+        return begin();
+    }
+
+    [[nodiscard]] const_iterator cend() const noexcept {
+        return end();
+    }
+
+    [[nodiscard]] const_reverse_iterator crbegin() const noexcept {
+        return rbegin();
+    }
+
+    [[nodiscard]] const_reverse_iterator crend() const noexcept {
+        return rend();
+    }
+
+protected:
+    /*
+    * 已存在相同key时不构造元素
+    * 叶子已满时先分裂，所需的节点在修改树之前一次性分配好
+    */
+    template <class K, class... Args>
+    std::pair<iterator, bool> EmplaceKey(const K& key, Args&&... args) {
+        if (root_ == kInvalidAddress) {
+            NodeAddress leaf_id = CreateNode(true);
+            Node* leaf = allocator_.reference(leaf_id);
+            try {
+                std::construct_at(leaf->GetElements(), std::forward<Args>(args)...);
+            }
+            catch (...) {
+                allocator_.deallocate(leaf_id);
+                throw;
+            }
+            leaf->SetCount(1);
+            root_ = leaf_id;
+            head_ = leaf_id;
+            tail_ = leaf_id;
+            size_ = 1;
+            return std::pair{ iterator{ this, leaf_id, 0 }, true };
+        }
+        Path path;
+        auto [leaf_id, slot] = Descend<false>(path, key);
+        Node* leaf = allocator_.reference(leaf_id);
+        if (slot < leaf->GetCount() && ThreeWayCompare::Compare(leaf->GetKey(slot), key) == 0) {
+            return std::pair{ iterator{ this, leaf_id, slot }, false };
+        }
+        if (leaf->GetCount() < kLeafCapacity) {
+            ConstructAt(leaf, slot, std::forward<Args>(args)...);
+            ++size_;
+            return std::pair{ iterator{ this, leaf_id, slot }, true };
+        }
+        /* 分裂会移动元素，元素先在栈上构造，之后的步骤不再调用用户代码(移动与key的复制除外) */
+        Element element(std::forward<Args>(args)...);
+        /* 分隔键即原叶子mid处的key，在移动元素之前复制，复制抛出时树仍保持原样 */
+        uint32_t mid = kLeafCapacity / 2;
+        Key separator(leaf->GetKey(mid));
+        std::array<NodeAddress, kMaxDepth + 1> fresh;
+        [[maybe_unused]] size_t fresh_count = AllocateSplitNodes(path, fresh);
+        size_t fresh_pos = 0;
+
+        NodeAddress right_id = fresh[fresh_pos++];
+        Node* right = std::construct_at(allocator_.reference(right_id), true);
+        Relocate(leaf->GetElements() + mid, kLeafCapacity - mid, right->GetElements());
+        right->SetCount(kLeafCapacity - mid);
+        leaf->SetCount(mid);
+        LinkLeafAfter(leaf_id, leaf, right_id, right);
+
+        NodeAddress target_id = leaf_id;
+        if (slot > mid) {
+            target_id = right_id;
+            slot -= mid;
+        }
+        Node* target = allocator_.reference(target_id);
+        OpenSlot(target, slot);
+        std::construct_at(target->GetElements() + slot, std::move(element));
+        target->SetCount(target->GetCount() + 1);
+        ++size_;
+
+        InsertSeparator(path, std::move(separator), right_id, fresh, fresh_pos);
+        assert(fresh_pos == fresh_count);
+        return std::pair{ iterator{ this, target_id, slot }, true };
+    }
+
+    /*
+    * 元素不参与任何聚合，无需刷新，只为与RbTree接口一致(见map的insert_or_assign)
+    */
+    void RefreshAggregate(const const_iterator&) noexcept {
+    }
+
+    /*
+    * 检查节点的key有序、分隔key与子树一致、非根节点至少半满、叶子深度相同且链表完整
+    */
+    bool VerifyTree() {
+        if (root_ == kInvalidAddress) {
+            return head_ == kInvalidAddress && tail_ == kInvalidAddress && size_ == 0;
+        }
+        size_t leaf_depth = 0;
+        size_type count = 0;
+        NodeAddress prev_leaf = kInvalidAddress;
+        if (!CheckNode(root_, nullptr, nullptr, 1, leaf_depth, count, prev_leaf)) {
+            return false;
+        }
+        return count == size_ && prev_leaf == tail_ && allocator_.reference(tail_)->GetNext() == kInvalidAddress;
+    }
+
+private:
+    const value_type& GetValue(NodeAddress leaf_id, uint32_t slot) const noexcept {
+        return Traits::GetValue(GetElement(leaf_id, slot));
+    }
+
+    Element& GetElement(NodeAddress leaf_id, uint32_t slot) const noexcept {
+        return allocator_.reference(leaf_id)->GetElements()[slot];
+    }
+
+    void Next(NodeAddress& leaf_id, uint32_t& slot) const noexcept {
+        Node* leaf = allocator_.reference(leaf_id);
+        if (++slot == leaf->GetCount()) {
+            leaf_id = leaf->GetNext();
+            slot = 0;
+        }
+    }
+
+    void Prev(NodeAddress& leaf_id, uint32_t& slot) const noexcept {
+        if (leaf_id == kInvalidAddress) {
+            leaf_id = tail_;
+            slot = allocator_.reference(tail_)->GetCount() - 1;
+        }
+        else if (slot == 0) {
+            leaf_id = allocator_.reference(leaf_id)->GetPrev();
+            slot = allocator_.reference(leaf_id)->GetCount() - 1;
+        }
+        else {
+            --slot;
+        }
+    }
+
+    /*
+    * 节点内顺序查找，返回小于(kUpper时不大于)key的元素个数
+    * 算术类型的key无分支地计数，编译器可以向量化，其余key遇到第一个不满足的位置即停止
+    */
+    template <bool kUpper, class K, class GetKeyAt>
+    static uint32_t CountBefore(uint32_t count, const K& key, GetKeyAt&& get_key) {
+        uint32_t pos = 0;
+        if constexpr (std::is_arithmetic_v<Key> && std::is_arithmetic_v<K>) {
+            for (uint32_t i = 0; i < count; ++i) {
+                auto ordering = ThreeWayCompare::Compare(get_key(i), key);
+                pos += kUpper ? ordering <= 0 : ordering < 0;
+            }
+        }
+        else {
+            while (pos < count) {
+                auto ordering = ThreeWayCompare::Compare(get_key(pos), key);
+                if (kUpper ? ordering > 0 : ordering >= 0) {
+                    break;
+                }
+                ++pos;
+            }
+        }
+        return pos;
+    }
+
+    /*
+    * 下降到key所在的叶子，返回叶子与其中的lower_bound(kUpper时为upper_bound)槽位
+    * 孩子i中的key位于[keys[i - 1], keys[i])，因此内部节点总是按不大于key的分隔key个数选择孩子
+    */
+    template <bool kUpper, class K>
+    std::pair<NodeAddress, uint32_t> Descend(Path& path, const K& key) const {
+        NodeAddress node_id = root_;
+        if (node_id == kInvalidAddress) {
+            return std::pair{ kInvalidAddress, 0u };
+        }
+        Node* node = allocator_.reference(node_id);
+        while (!node->IsLeaf()) {
+            Key* keys = node->GetKeys();
+            uint32_t index = CountBefore<true>(node->GetCount(), key, [&](uint32_t i) -> const Key& {
+                return keys[i];
+            });
+            path.push_back(node_id, index);
+            node_id = node->GetChildren()[index];
+            node = allocator_.reference(node_id);
+        }
+        uint32_t slot = CountBefore<kUpper>(node->GetCount(), key, [&](uint32_t i) -> const Key& {
+            return node->GetKey(i);
+        });
+        return std::pair{ node_id, slot };
+    }
+
+    /*
+    * 槽位越过叶子末尾时结果位于下一个叶子的开头
+    */
+    template <bool kUpper, class K>
+    std::pair<NodeAddress, uint32_t> Bound(const K& key) const {
+        Path path;
+        auto [leaf_id, slot] = Descend<kUpper>(path, key);
+        return Normalize(leaf_id, slot);
+    }
+
+    /*
+    * 不在本叶子的末尾时key不存在，叶子之前的分隔key不大于key，之后的叶子都大于key
+    */
+    template <class K>
+    std::pair<NodeAddress, uint32_t> Find(const K& key) const {
+        Path path;
+        auto [leaf_id, slot] = Descend<false>(path, key);
+        if (leaf_id == kInvalidAddress) {
+            return std::pair{ kInvalidAddress, 0u };
+        }
+        Node* leaf = allocator_.reference(leaf_id);
+        if (slot == leaf->GetCount() || ThreeWayCompare::Compare(leaf->GetKey(slot), key) != 0) {
+            return std::pair{ kInvalidAddress, 0u };
+        }
+        return std::pair{ leaf_id, slot };
+    }
+
+    std::pair<NodeAddress, uint32_t> Normalize(NodeAddress leaf_id, uint32_t slot) const noexcept {
+        if (leaf_id != kInvalidAddress) {
+            Node* leaf = allocator_.reference(leaf_id);
+            if (slot == leaf->GetCount()) {
+                return std::pair{ leaf->GetNext(), 0u };
+            }
+        }
+        return std::pair{ leaf_id, slot };
+    }
+
+    template <class It, class K>
+    It EqualRangeEnd(It first, const K& key) const {
+        if (first.leaf_address_ != kInvalidAddress && ThreeWayCompare::Compare(Traits::GetKey(*first), key) == 0) {
+            ++first;
+        }
+        return first;
+    }
+
+    /*
+    * 分配未构造的节点，内存池的地址可能比NodeAddress宽，先在原宽度上检查上限
+    * 超出上限的地址若是内存池真实分配的节点(而非其无效地址)则先归还，否则该节点永久丢失
+    */
+    NodeAddress AllocateNode() {
+        auto node_id = allocator_.allocate();
+        if (node_id > kMaxAddress) {
+            if constexpr (requires { AllocatorType::kInvalidAddress; }) {
+                if (node_id != AllocatorType::kInvalidAddress) {
+                    allocator_.deallocate(node_id);
+                }
+            }
+            else {
+                allocator_.deallocate(node_id);
+            }
+            throw std::bad_alloc();     // "The maximum node limit of the tree has been reached."
+        }
+        return static_cast<NodeAddress>(node_id);
+    }
+
+    NodeAddress CreateNode(bool leaf) {
+        NodeAddress node_id = AllocateNode();
+        std::construct_at(allocator_.reference(node_id), leaf);
+        return node_id;
+    }
+
+    /*
+    * 叶子分裂时逐层向上，路径上连续已满的内部节点都要分裂，全满时还需要新的根
+    */
+    size_t AllocateSplitNodes(const Path& path, std::array<NodeAddress, kMaxDepth + 1>& fresh) {
+        size_t count = 1;
+        Path rest = path;
+        for (; !rest.empty(); rest.pop_back()) {
+            if (allocator_.reference(rest.back_node())->GetCount() < kInnerCapacity) {
+                break;
+            }
+            ++count;
+        }
+        if (rest.empty()) {
+            ++count;
+        }
+        size_t allocated = 0;
+        try {
+            for (; allocated < count; ++allocated) {
+                fresh[allocated] = AllocateNode();
+            }
+        }
+        catch (...) {
+            while (allocated > 0) {
+                allocator_.deallocate(fresh[--allocated]);
+            }
+            throw;
+        }
+        return count;
+    }
+
+    /*
+    * 将separator与其右侧的孩子插入路径末尾的内部节点，节点已满时分裂并继续向上
+    * 中间的key上移到父节点，分裂到根时树长高一层
+    */
+    void InsertSeparator(Path& path, Key separator, NodeAddress child_id, const std::array<NodeAddress, kMaxDepth + 1>& fresh, size_t& fresh_pos) {
+        for (; !path.empty(); path.pop_back()) {
+            NodeAddress node_id = path.back_node();
+            uint32_t index = path.back_index();
+            Node* node = allocator_.reference(node_id);
+            if (node->GetCount() < kInnerCapacity) {
+                InsertKey(node, index, std::move(separator), child_id);
+                return;
+            }
+            NodeAddress right_id = fresh[fresh_pos++];
+            Node* right = std::construct_at(allocator_.reference(right_id), false);
+            uint32_t mid = kInnerCapacity / 2;
+            Relocate(node->GetKeys() + mid + 1, kInnerCapacity - mid - 1, right->GetKeys());
+            std::copy_n(node->GetChildren() + mid + 1, kInnerCapacity - mid, right->GetChildren());
+            right->SetCount(kInnerCapacity - mid - 1);
+            Key up = std::move(node->GetKeys()[mid]);
+            std::destroy_at(node->GetKeys() + mid);
+            node->SetCount(mid);
+            if (index <= mid) {
+                InsertKey(node, index, std::move(separator), child_id);
+            }
+            else {
+                InsertKey(right, index - mid - 1, std::move(separator), child_id);
+            }
+            separator = std::move(up);
+            child_id = right_id;
+        }
+        NodeAddress root_id = fresh[fresh_pos++];
+        Node* root = std::construct_at(allocator_.reference(root_id), false);
+        std::construct_at(root->GetKeys(), std::move(separator));
+        root->GetChildren()[0] = root_;
+        root->GetChildren()[1] = child_id;
+        root->SetCount(1);
+        root_ = root_id;
+    }
+
+    /*
+    * 在未满的内部节点的index处插入key，child成为其右侧的孩子
+    */
+    void InsertKey(Node* node, uint32_t index, Key&& key, NodeAddress child_id) {
+        uint32_t count = node->GetCount();
+        Key* keys = node->GetKeys();
+        NodeAddress* children = node->GetChildren();
+        Relocate(keys + index, count - index, keys + index + 1);
+        std::construct_at(keys + index, std::move(key));
+        std::copy_backward(children + index + 1, children + count + 1, children + count + 2);
+        children[index + 1] = child_id;
+        node->SetCount(count + 1);
+    }
+
+    /*
+    * 删除内部节点的第index个key及其右侧的孩子
+    */
+    void RemoveKey(Node* node, uint32_t index) noexcept {
+        uint32_t count = node->GetCount();
+        Key* keys = node->GetKeys();
+        NodeAddress* children = node->GetChildren();
+        std::destroy_at(keys + index);
+        Relocate(keys + index + 1, count - index - 1, keys + index);
+        std::copy(children + index + 2, children + count + 1, children + index + 1);
+        node->SetCount(count - 1);
+    }
+
+    /*
+    * 在未满的叶子的slot处原位构造元素，构造失败时恢复原状
+    */
+    template <class... Args>
+    void ConstructAt(Node* leaf, uint32_t slot, Args&&... args) {
+        OpenSlot(leaf, slot);
+        try {
+            std::construct_at(leaf->GetElements() + slot, std::forward<Args>(args)...);
+        }
+        catch (...) {
+            Relocate(leaf->GetElements() + slot + 1, leaf->GetCount() - slot, leaf->GetElements() + slot);
+            throw;
+        }
+        leaf->SetCount(leaf->GetCount() + 1);
+    }
+
+    /*
+    * 将[slot, count)后移一位，slot成为未构造的槽位，count不变
+    */
+    void OpenSlot(Node* leaf, uint32_t slot) {
+        Relocate(leaf->GetElements() + slot, leaf->GetCount() - slot, leaf->GetElements() + slot + 1);
+    }
+
+    /*
+    * 将count个对象移动到dest并析构原对象，区间可以重叠
+    */
+    template <class T>
+    static void Relocate(T* first, uint32_t count, T* dest) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            std::memmove(static_cast<void*>(dest), first, count * sizeof(T));
+        }
+        else if (dest < first) {
+            for (uint32_t i = 0; i < count; ++i) {
+                std::construct_at(dest + i, std::move(first[i]));
+                std::destroy_at(first + i);
+            }
+        }
+        else {
+            for (uint32_t i = count; i > 0; --i) {
+                std::construct_at(dest + i - 1, std::move(first[i - 1]));
+                std::destroy_at(first + i - 1);
+            }
+        }
+    }
+
+    void LinkLeafAfter(NodeAddress leaf_id, Node* leaf, NodeAddress right_id, Node* right) noexcept {
+        right->SetPrev(leaf_id);
+        right->SetNext(leaf->GetNext());
+        if (leaf->GetNext() != kInvalidAddress) {
+            allocator_.reference(leaf->GetNext())->SetPrev(right_id);
+        }
+        else {
+            tail_ = right_id;
+        }
+        leaf->SetNext(right_id);
+    }
+
+    void UnlinkLeaf(Node* leaf) noexcept {
+        if (leaf->GetPrev() != kInvalidAddress) {
+            allocator_.reference(leaf->GetPrev())->SetNext(leaf->GetNext());
+        }
+        else {
+            head_ = leaf->GetNext();
+        }
+        if (leaf->GetNext() != kInvalidAddress) {
+            allocator_.reference(leaf->GetNext())->SetPrev(leaf->GetPrev());
+        }
+        else {
+            tail_ = leaf->GetPrev();
+        }
+    }
+
+    /*
+    * 删除叶子中的元素，不足半满时先向相邻的兄弟借，兄弟也只有半满时合并，合并会使父节点少一个key
+    * 借与合并只发生在同一父节点下的兄弟之间，返回被删除元素的后继在调整后的位置
+    */
+    iterator EraseAt(Path& path, NodeAddress leaf_id, uint32_t slot) {
+        Node* leaf = allocator_.reference(leaf_id);
+        std::destroy_at(leaf->GetElements() + slot);
+        Relocate(leaf->GetElements() + slot + 1, leaf->GetCount() - slot - 1, leaf->GetElements() + slot);
+        leaf->SetCount(leaf->GetCount() - 1);
+        --size_;
+
+        if (path.empty()) {
+            if (leaf->GetCount() == 0) {
+                allocator_.deallocate(leaf_id);
+                root_ = kInvalidAddress;
+                head_ = kInvalidAddress;
+                tail_ = kInvalidAddress;
+                return end();
+            }
+            auto [next_id, next_slot] = Normalize(leaf_id, slot);
+            return iterator{ this, next_id, next_slot };
+        }
+        if (leaf->GetCount() >= kLeafMin) {
+            auto [next_id, next_slot] = Normalize(leaf_id, slot);
+            return iterator{ this, next_id, next_slot };
+        }
+
+        NodeAddress parent_id = path.back_node();
+        uint32_t index = path.back_index();
+        Node* parent = allocator_.reference(parent_id);
+        NodeAddress* children = parent->GetChildren();
+        if (index > 0) {
+            NodeAddress left_id = children[index - 1];
+            Node* left = allocator_.reference(left_id);
+            if (left->GetCount() > kLeafMin) {
+                OpenSlot(leaf, 0);
+                Relocate(left->GetElements() + left->GetCount() - 1, 1, leaf->GetElements());
+                left->SetCount(left->GetCount() - 1);
+                leaf->SetCount(leaf->GetCount() + 1);
+                parent->GetKeys()[index - 1] = leaf->GetKey(0);
+                auto [next_id, next_slot] = Normalize(leaf_id, slot + 1);
+                return iterator{ this, next_id, next_slot };
+            }
+        }
+        if (index < parent->GetCount()) {
+            NodeAddress right_id = children[index + 1];
+            Node* right = allocator_.reference(right_id);
+            if (right->GetCount() > kLeafMin) {
+                Relocate(right->GetElements(), 1, leaf->GetElements() + leaf->GetCount());
+                Relocate(right->GetElements() + 1, right->GetCount() - 1, right->GetElements());
+                right->SetCount(right->GetCount() - 1);
+                leaf->SetCount(leaf->GetCount() + 1);
+                parent->GetKeys()[index] = right->GetKey(0);
+                return iterator{ this, leaf_id, slot };
+            }
+        }
+
+        NodeAddress next_id = leaf_id;
+        uint32_t next_slot = slot;
+        if (index > 0) {
+            NodeAddress left_id = children[index - 1];
+            Node* left = allocator_.reference(left_id);
+            next_id = left_id;
+            next_slot = left->GetCount() + slot;
+            MergeLeaf(left, leaf_id, leaf);
+            RemoveKey(parent, index - 1);
+        }
+        else {
+            NodeAddress right_id = children[index + 1];
+            MergeLeaf(leaf, right_id, allocator_.reference(right_id));
+            RemoveKey(parent, index);
+        }
+        std::tie(next_id, next_slot) = Normalize(next_id, next_slot);
+        RebalanceInner(path);
+        return iterator{ this, next_id, next_slot };
+    }
+
+    /*
+    * 将right的元素全部移入left，并释放right
+    */
+    void MergeLeaf(Node* left, NodeAddress right_id, Node* right) noexcept {
+        Relocate(right->GetElements(), right->GetCount(), left->GetElements() + left->GetCount());
+        left->SetCount(left->GetCount() + right->GetCount());
+        UnlinkLeaf(right);
+        allocator_.deallocate(right_id);
+    }
+
+    /*
+    * path末尾的内部节点刚失去一个key，不足时向兄弟借(经由父节点的分隔key旋转)或与兄弟合并，合并后继续向上
+    * 根没有key时以唯一的孩子为新根，树降低一层
+    */
+    void RebalanceInner(Path& path) {
+        while (true) {
+            NodeAddress node_id = path.back_node();
+            Node* node = allocator_.reference(node_id);
+            path.pop_back();
+            if (path.empty()) {
+                if (node->GetCount() == 0) {
+                    root_ = node->GetChildren()[0];
+                    allocator_.deallocate(node_id);
+                }
+                return;
+            }
+            if (node->GetCount() >= kInnerMin) {
+                return;
+            }
+            NodeAddress parent_id = path.back_node();
+            uint32_t index = path.back_index();
+            Node* parent = allocator_.reference(parent_id);
+            Key* parent_keys = parent->GetKeys();
+            NodeAddress* children = parent->GetChildren();
+            if (index > 0) {
+                Node* left = allocator_.reference(children[index - 1]);
+                uint32_t left_count = left->GetCount();
+                if (left_count > kInnerMin) {
+                    InsertKeyFront(node, std::move(parent_keys[index - 1]), left->GetChildren()[left_count]);
+                    parent_keys[index - 1] = std::move(left->GetKeys()[left_count - 1]);
+                    std::destroy_at(left->GetKeys() + left_count - 1);
+                    left->SetCount(left_count - 1);
+                    return;
+                }
+            }
+            if (index < parent->GetCount()) {
+                Node* right = allocator_.reference(children[index + 1]);
+                if (right->GetCount() > kInnerMin) {
+                    uint32_t count = node->GetCount();
+                    std::construct_at(node->GetKeys() + count, std::move(parent_keys[index]));
+                    node->GetChildren()[count + 1] = right->GetChildren()[0];
+                    node->SetCount(count + 1);
+                    parent_keys[index] = std::move(right->GetKeys()[0]);
+                    std::destroy_at(right->GetKeys());
+                    Relocate(right->GetKeys() + 1, right->GetCount() - 1, right->GetKeys());
+                    std::copy(right->GetChildren() + 1, right->GetChildren() + right->GetCount() + 1, right->GetChildren());
+                    right->SetCount(right->GetCount() - 1);
+                    return;
+                }
+            }
+            if (index > 0) {
+                MergeInner(allocator_.reference(children[index - 1]), parent, index - 1, node_id, node);
+            }
+            else {
+                NodeAddress right_id = children[index + 1];
+                MergeInner(node, parent, index, right_id, allocator_.reference(right_id));
+            }
+        }
+    }
+
+    void InsertKeyFront(Node* node, Key&& key, NodeAddress child_id) {
+        uint32_t count = node->GetCount();
+        Key* keys = node->GetKeys();
+        NodeAddress* children = node->GetChildren();
+        Relocate(keys, count, keys + 1);
+        std::construct_at(keys, std::move(key));
+        std::copy_backward(children, children + count + 1, children + count + 2);
+        children[0] = child_id;
+        node->SetCount(count + 1);
+    }
+
+    /*
+    * 父节点的第index个key下移，与right的key和孩子一起并入left，释放right
+    */
+    void MergeInner(Node* left, Node* parent, uint32_t index, NodeAddress right_id, Node* right) {
+        uint32_t left_count = left->GetCount();
+        uint32_t right_count = right->GetCount();
+        std::construct_at(left->GetKeys() + left_count, std::move(parent->GetKeys()[index]));
+        Relocate(right->GetKeys(), right_count, left->GetKeys() + left_count + 1);
+        std::copy_n(right->GetChildren(), right_count + 1, left->GetChildren() + left_count + 1);
+        left->SetCount(left_count + 1 + right_count);
+        allocator_.deallocate(right_id);
+        RemoveKey(parent, index);
+    }
+
+    /*
+    * 由有序且无重复的序列自底向上构建，叶子与内部节点都尽量均分，每个节点至少半满
+    * get(i)返回第i个元素，可以是左值或右值
+    */
+    template <class Get>
+    void BuildSorted(size_type count, Get&& get) {
+        assert(root_ == kInvalidAddress);
+        if (count == 0) {
+            return;
+        }
+        std::vector<NodeAddress> level;
+        /* 每个节点子树中最小的key所在的叶子 */
+        std::vector<NodeAddress> lows;
+        /* 已创建的内部节点，构建失败时析构其中的key */
+        std::vector<NodeAddress> inners;
+        try {
+            size_type leaf_count = (count + kLeafCapacity - 1) / kLeafCapacity;
+            level.reserve(leaf_count);
+            size_type pos = 0;
+            for (size_type i = 0; i < leaf_count; ++i) {
+                uint32_t fill = static_cast<uint32_t>(count / leaf_count + (i < count % leaf_count ? 1 : 0));
+                NodeAddress leaf_id = CreateNode(true);
+                Node* leaf = allocator_.reference(leaf_id);
+                if (tail_ == kInvalidAddress) {
+                    head_ = leaf_id;
+                    tail_ = leaf_id;
+                }
+                else {
+                    LinkLeafAfter(tail_, allocator_.reference(tail_), leaf_id, leaf);
+                }
+                level.push_back(leaf_id);
+                for (uint32_t j = 0; j < fill; ++j) {
+                    std::construct_at(leaf->GetElements() + j, get(pos++));
+                    leaf->SetCount(j + 1);
+                }
+            }
+            lows = level;
+            while (level.size() > 1) {
+                size_t fanout = kInnerCapacity + 1;
+                size_t parent_count = (level.size() + fanout - 1) / fanout;
+                std::vector<NodeAddress> parents;
+                std::vector<NodeAddress> parent_lows;
+                parents.reserve(parent_count);
+                parent_lows.reserve(parent_count);
+                size_t child_pos = 0;
+                for (size_t i = 0; i < parent_count; ++i) {
+                    size_t fill = level.size() / parent_count + (i < level.size() % parent_count ? 1 : 0);
+                    NodeAddress node_id = CreateNode(false);
+                    Node* node = allocator_.reference(node_id);
+                    inners.push_back(node_id);
+                    parents.push_back(node_id);
+                    parent_lows.push_back(lows[child_pos]);
+                    node->GetChildren()[0] = level[child_pos];
+                    for (size_t j = 1; j < fill; ++j) {
+                        std::construct_at(node->GetKeys() + j - 1, allocator_.reference(lows[child_pos + j])->GetKey(0));
+                        node->GetChildren()[j] = level[child_pos + j];
+                        node->SetCount(static_cast<uint32_t>(j));
+                    }
+                    child_pos += fill;
+                }
+                level = std::move(parents);
+                lows = std::move(parent_lows);
+            }
+            root_ = level[0];
+            size_ = count;
+        }
+        catch (...) {
+            /* 叶子已通过链表相连，析构元素与已构造的key后直接丢弃整个内存池 */
+            if constexpr (!std::is_trivially_destructible_v<Key>) {
+                for (NodeAddress node_id : inners) {
+                    Node* node = allocator_.reference(node_id);
+                    std::destroy_n(node->GetKeys(), node->GetCount());
+                }
+            }
+            DestroyLeaves();
+            allocator_ = AllocatorType{};
+            root_ = kInvalidAddress;
+            head_ = kInvalidAddress;
+            tail_ = kInvalidAddress;
+            throw;
+        }
+    }
+
+    /*
+    * 只析构元素与分隔key，不归还节点，由调用者丢弃整个内存池
+    * 都可平凡析构时不访问任何节点
+    */
+    void DestroyElements() noexcept {
+        if constexpr (!std::is_trivially_destructible_v<Key>) {
+            if (root_ != kInvalidAddress) {
+                DestroyKeys(root_);
+            }
+        }
+        DestroyLeaves();
+    }
+
+    void DestroyLeaves() noexcept {
+        if constexpr (!std::is_trivially_destructible_v<Element>) {
+            for (NodeAddress leaf_id = head_; leaf_id != kInvalidAddress; ) {
+                Node* leaf = allocator_.reference(leaf_id);
+                std::destroy_n(leaf->GetElements(), leaf->GetCount());
+                leaf_id = leaf->GetNext();
+            }
+        }
+    }
+
+    void DestroyKeys(NodeAddress node_id) noexcept {
+        Node* node = allocator_.reference(node_id);
+        if (node->IsLeaf()) {
+            return;
+        }
+        std::destroy_n(node->GetKeys(), node->GetCount());
+        for (uint32_t i = 0; i <= node->GetCount(); ++i) {
+            DestroyKeys(node->GetChildren()[i]);
+        }
+    }
+
+    /*
+    * 子树中的key都位于[low, high)，low/high为空表示不限
+    */
+    bool CheckNode(NodeAddress node_id, const Key* low, const Key* high, size_t depth, size_t& leaf_depth, size_type& count, NodeAddress& prev_leaf) {
+        Node* node = allocator_.reference(node_id);
+        uint32_t node_count = node->GetCount();
+        bool is_root = node_id == root_;
+        auto in_range = [&](const Key& key) {
+            return (!low || ThreeWayCompare::Compare(*low, key) <= 0) && (!high || ThreeWayCompare::Compare(key, *high) < 0);
+        };
+        if (node->IsLeaf()) {
+            if (node_count == 0 || node_count > kLeafCapacity || (!is_root && node_count < kLeafMin)) {
+                return false;
+            }
+            if (leaf_depth == 0) {
+                leaf_depth = depth;
+            }
+            if (leaf_depth != depth || node->GetPrev() != prev_leaf) {
+                return false;
+            }
+            if (prev_leaf == kInvalidAddress ? head_ != node_id : allocator_.reference(prev_leaf)->GetNext() != node_id) {
+                return false;
+            }
+            for (uint32_t i = 0; i < node_count; ++i) {
+                if (!in_range(node->GetKey(i)) || (i > 0 && ThreeWayCompare::Compare(node->GetKey(i - 1), node->GetKey(i)) >= 0)) {
+                    return false;
+                }
+            }
+            prev_leaf = node_id;
+            count += node_count;
+            return true;
+        }
+        if (node_count == 0 || node_count > kInnerCapacity || (!is_root && node_count < kInnerMin)) {
+            return false;
+        }
+        Key* keys = node->GetKeys();
+        for (uint32_t i = 0; i < node_count; ++i) {
+            if (!in_range(keys[i]) || (i > 0 && ThreeWayCompare::Compare(keys[i - 1], keys[i]) >= 0)) {
+                return false;
+            }
+        }
+        for (uint32_t i = 0; i <= node_count; ++i) {
+            const Key* child_low = i == 0 ? low : &keys[i - 1];
+            const Key* child_high = i == node_count ? high : &keys[i];
+            if (!CheckNode(node->GetChildren()[i], child_low, child_high, depth + 1, leaf_depth, count, prev_leaf)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    mutable AllocatorType allocator_;
+    NodeAddress root_ = kInvalidAddress;
+    /* 叶子链表的首尾，begin()与--end()都是O(1) */
+    NodeAddress head_ = kInvalidAddress;
+    NodeAddress tail_ = kInvalidAddress;
+    size_type size_ = 0;
+};
+
+} // namespace rbt
+
+#endif // RBT_B_TREE_HPP_
@@ -0,0 +1,106 @@
+#ifndef RBT_COMPARE_HPP_
+#define RBT_COMPARE_HPP_
+
+#include <compare>
+#include <concepts>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace rbt {
+
+namespace detail {
+
+/*
+* K能否按Key(basic_string)的字符类型视为string_view，非字符串Key恒为false
+*/
+template <class Key, class K>
+struct IsStringViewable : std::false_type {};
+
+template <class CharT, class CharTraits, class Alloc, class K>
+struct IsStringViewable<std::basic_string<CharT, CharTraits, Alloc>, K>
+    : std::is_convertible<const K&, std::basic_string_view<CharT, CharTraits>> {};
+
+template <class Compare, class Key>
+constexpr bool kIsLess = std::is_same_v<Compare, std::less<Key>> || std::is_same_v<Compare, std::less<>>;
+
+template <class Compare, class Key>
+constexpr bool kIsGreater = std::is_same_v<Compare, std::greater<Key>> || std::is_same_v<Compare, std::greater<>>;
+
+/*
+* 将任意三路比较结果收敛为strong_ordering，equal表示等价
+*/
+template <class Ordering>
+constexpr std::strong_ordering ToStrongOrdering(Ordering ordering) noexcept {
+    if constexpr (std::is_same_v<Ordering, std::strong_ordering>) {
+        return ordering;
+    }
+    else if constexpr (std::is_integral_v<Ordering>) {
+        return ordering <=> 0;
+    }
+    else {
+        return ordering < 0 ? std::strong_ordering::less :
+            ordering > 0 ? std::strong_ordering::greater : std::strong_ordering::equal;
+    }
+}
+
+/*
+* 与std::less一致的三路比较，只对能保证语义一致的类型走快速路径
+*/
+template <class Key, class K1, class K2>
+constexpr std::strong_ordering NaturalCompare(const K1& a, const K2& b) {
+    if constexpr (std::is_integral_v<K1> && std::is_integral_v<K2> && std::is_same_v<K1, K2>) {
+        /* 整数直接三路比较，编译为无分支的setcc */
+        return a <=> b;
+    }
+    else if constexpr (IsStringViewable<Key, K1>::value && IsStringViewable<Key, K2>::value) {
+        /* 字符串使用traits_type::compare(memcmp)，一次调用同时得出大小与相等 */
+        using View = std::basic_string_view<typename Key::value_type, typename Key::traits_type>;
+        return View(a).compare(View(b)) <=> 0;
+    }
+    else if constexpr (std::is_arithmetic_v<K1> || std::is_arithmetic_v<K2>) {
+        /* 浮点等类型的<=>是偏序，交由<决定，保持与std::less一致 */
+        return a < b ? std::strong_ordering::less :
+            b < a ? std::strong_ordering::greater : std::strong_ordering::equal;
+    }
+    else if constexpr (requires { { a <=> b } -> std::convertible_to<std::weak_ordering>; }) {
+        return ToStrongOrdering(a <=> b);
+    }
+    else {
+        return a < b ? std::strong_ordering::less :
+            b < a ? std::strong_ordering::greater : std::strong_ordering::equal;
+    }
+}
+
+} // namespace detail
+
+/*
+* Key的三路比较策略，由Traits提供给RbTree
+* 每层只进行一次比较，std::less/std::greater会按key类型选择编译期快速路径
+* 其余自定义比较器退化为至多两次调用
+*/
+template <class Key, class KeyCompare>
+class ThreeWayCompare {
+public:
+    template <class K1, class K2>
+    static constexpr std::strong_ordering Compare(const K1& a, const K2& b) {
+        if constexpr (detail::kIsLess<KeyCompare, Key>) {
+            return detail::NaturalCompare<Key>(a, b);
+        }
+        else if constexpr (detail::kIsGreater<KeyCompare, Key>) {
+            return detail::NaturalCompare<Key>(b, a);
+        }
+        else {
+            KeyCompare compare{};
+            if (compare(a, b)) {
+                return std::strong_ordering::less;
+            }
+            return compare(b, a) ? std::strong_ordering::greater : std::strong_ordering::equal;
+        }
+    }
+};
+
+} // namespace rbt
+
+#endif // RBT_COMPARE_HPP_
@@ -15,16 +15,205 @@
 */
 
 #include <utility>
+#include <tuple>
+#include <stdexcept>
+#include <concepts>
+
+#include <rbt/rb_tree.hpp>
+#include <rbt/b_tree.hpp>
 
 namespace rbt {
 
-template <class Key, 
-    class Value, 
-    class Comparer = std::less<Key>, 
-    class _Alloc = std::allocator<std::pair<const Key, Value>>>
-class map {
+template <class KeyT, class MappedT, class KeyCompareT, bool kMultiT = false, template <class> class PoolT = fpoo::CompactMemoryPool, bool kOrderStatisticT = false, class MonoidT = void, class NodeAddressT = uint32_t>
+class MapTraits {
 public:
+    static constexpr bool kMulti = kMultiT;
+    /* 节点额外记录子树大小，提供nth/rank/count_range */
+    static constexpr bool kOrderStatistic = kOrderStatisticT;
+    /* 节点额外记录子树聚合值，提供reduce，void表示不启用 */
+    using Monoid = MonoidT;
+    /* 节点地址宽度，uint16_t/uint32_t/uint64_t */
+    using NodeAddress = NodeAddressT;
+
+    /* 节点所在的内存池，可换为MappedPool以映射到文件 */
+    template <class T>
+    using Pool = PoolT<T>;
+
+    using Key = KeyT;
+    using Mapped = MappedT;
+    using Value = std::pair<const Key, Mapped>;
+    /* key与value直接以pair存放在节点中，不额外包装 */
+    using Element = Value;
+
+    using KeyCompare = KeyCompareT;
+    class ValueCompare {
+    public:
+        bool operator()(const Value& a, const Value& b) const {
+            return KeyCompare{}(a.first, b.first);
+        }
+    };
+    using ThreeWayCompare = rbt::ThreeWayCompare<Key, KeyCompare>;
+
+    static const Key& GetKey(const Element& element) {
+        return element.first;
+    }
+
+    static Value& GetValue(Element& element) {
+        return element;
+    }
+
+    /*
+    * 无需构造元素即可取得key的emplace参数形式
+    */
+    template <class K, class M>
+        requires std::same_as<std::remove_cvref_t<K>, Key>
+    static const Key& ExtractKey(const K& key, const M&) {
+        return key;
+    }
+
+    template <class K, class M>
+        requires std::same_as<std::remove_cvref_t<K>, Key>
+    static const Key& ExtractKey(const std::pair<K, M>& value) {
+        return value.first;
+    }
+
+    template <class K, class... Args>
+        requires std::same_as<std::remove_cvref_t<K>, Key>
+    static const Key& ExtractKey(std::piecewise_construct_t, const std::tuple<K>& key, const std::tuple<Args...>&) {
+        return std::get<0>(key);
+    }
+};
+
+namespace detail {
+
+/*
+* map与btree_map共用的按key访问的接口，Tree为RbTree或BTree
+*/
+template <class Tree>
+class MapInterface : public Tree {
+public:
+    using mapped_type = typename Tree::value_type::second_type;
+    using typename Tree::key_type;
+    using typename Tree::value_type;
+    using typename Tree::iterator;
+    using typename Tree::const_iterator;
+
+    using Tree::Tree;
+
+    mapped_type& operator[](const key_type& key) {
+        return try_emplace(key).first->second;
+    }
+
+    mapped_type& operator[](key_type&& key) {
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    mapped_type& at(const key_type& key) {
+        auto iter = this->find(key);
+        if (iter == this->end()) {
+            throw std::out_of_range("invalid map<K, T> key");
+        }
+        return iter->second;
+    }
+
+    const mapped_type& at(const key_type& key) const {
+        auto iter = this->find(key);
+        if (iter == this->end()) {
+            throw std::out_of_range("invalid map<K, T> key");
+        }
+        return iter->second;
+    }
+
+    /*
+    * key已存在时不分配节点，也不会移动args
+    */
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) {
+        return this->EmplaceKey(key,
+            std::piecewise_construct,
+            std::forward_as_tuple(key),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+    }
 
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args) {
+        return this->EmplaceKey(key,
+            std::piecewise_construct,
+            std::forward_as_tuple(std::move(key)),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& obj) {
+        auto result = try_emplace(key, std::forward<M>(obj));
+        if (!result.second) {
+            result.first->second = std::forward<M>(obj);
+            this->RefreshAggregate(result.first);
+        }
+        return result;
+    }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& obj) {
+        auto result = try_emplace(std::move(key), std::forward<M>(obj));
+        if (!result.second) {
+            result.first->second = std::forward<M>(obj);
+            this->RefreshAggregate(result.first);
+        }
+        return result;
+    }
+};
+
+} // namespace detail
+
+template <class Key, class T, class Compare = std::less<Key>, template <class> class Pool = fpoo::CompactMemoryPool, bool kOrderStatistic = false, class Monoid = void, class NodeAddress = uint32_t>
+class map : public detail::MapInterface<RbTree<MapTraits<Key, T, Compare, false, Pool, kOrderStatistic, Monoid, NodeAddress>>> {
+private:
+    using Base = detail::MapInterface<RbTree<MapTraits<Key, T, Compare, false, Pool, kOrderStatistic, Monoid, NodeAddress>>>;
+public:
+    using Base::Base;
+};
+
+/*
+* 相等的key按插入顺序排列
+*/
+template <class Key, class T, class Compare = std::less<Key>, template <class> class Pool = fpoo::CompactMemoryPool, bool kOrderStatistic = false, class Monoid = void, class NodeAddress = uint32_t>
+class multimap : public RbTree<MapTraits<Key, T, Compare, true, Pool, kOrderStatistic, Monoid, NodeAddress>> {
+private:
+    using Tree = RbTree<MapTraits<Key, T, Compare, true, Pool, kOrderStatistic, Monoid, NodeAddress>>;
+public:
+    using mapped_type = T;
+    using typename Tree::value_type;
+    using typename Tree::iterator;
+
+    using Tree::Tree;
+    using Tree::insert;
+
+    /* 总是插入成功，因此只返回迭代器 */
+    iterator insert(const value_type& value) {
+        return Tree::insert(value).first;
+    }
+
+    iterator insert(value_type&& value) {
+        return Tree::insert(std::move(value)).first;
+    }
+
+    template <class... Args>
+    iterator emplace(Args&&... args) {
+        return Tree::emplace(std::forward<Args>(args)...).first;
+    }
+};
+
+/*
+* 以B+树为引擎的map，模板参数与map的前几个一致，替换类型名即可切换
+* 查找与遍历更快、空间更省，但插入或删除会使所有迭代器失效(见BTree)
+*/
+template <class Key, class T, class Compare = std::less<Key>, template <class> class Pool = fpoo::CompactMemoryPool>
+class btree_map : public detail::MapInterface<BTree<MapTraits<Key, T, Compare, false, Pool>>> {
+private:
+    using Base = detail::MapInterface<BTree<MapTraits<Key, T, Compare, false, Pool>>>;
+public:
+    using Base::Base;
 };
 
 } // namespace rbt
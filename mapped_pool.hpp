@@ -0,0 +1,457 @@
+#ifndef RBT_MAPPED_POOL_HPP_
+#define RBT_MAPPED_POOL_HPP_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <string>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace rbt {
+
+enum class MapMode {
+    kReadOnly,
+    kReadWrite,
+};
+
+/*
+* 按字节写入文件、映射回来后仍然有效的类型
+* pair因为自定义了赋值运算符而不是trivially copyable，单独放行
+*/
+template <class T>
+struct IsBitwisePersistable : std::is_trivially_copyable<T> {};
+
+template <class T1, class T2>
+struct IsBitwisePersistable<std::pair<T1, T2>>
+    : std::bool_constant<IsBitwisePersistable<std::remove_const_t<T1>>::value && IsBitwisePersistable<T2>::value> {};
+
+namespace detail {
+
+/*
+* 节点类型声明了Address时按其宽度编址，否则为32位
+*/
+template <class T, class = void>
+struct PoolAddressOf {
+    using type = uint32_t;
+};
+
+template <class T>
+struct PoolAddressOf<T, std::void_t<typename T::Address>> {
+    using type = typename T::Address;
+};
+
+} // namespace detail
+
+/*
+* 文件头，节点数组紧随其后
+* 节点之间只通过下标引用，因此整个映像与映射地址无关
+* 各字段统一按64位存放，address_size记录节点链接的宽度
+*/
+struct alignas(64) MappedPoolHeader {
+    static constexpr char kMagic[8] = { 'r', 'b', 't', 'p', 'o', 'o', 'l', '\0' };
+    static constexpr uint32_t kVersion = 2;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t node_size;
+    uint32_t address_size;
+    uint64_t capacity;      /* 可容纳的节点数 */
+    uint64_t next;          /* 从未分配过的第一个下标 */
+    uint64_t free_head;     /* 空闲链表，链接存放在空闲节点的前address_size字节 */
+    uint64_t root;
+    uint64_t size;
+};
+
+/*
+* 连续内存上的节点池，接口与fpoo::CompactMemoryPool一致
+* 默认使用匿名内存，open之后运行在文件映射之上，修改直接写回文件
+* 扩容会整体重新映射，调用allocate之后先前reference得到的指针失效，包括指向节点中元素的指针与引用
+*/
+template <class T>
+class MappedPool {
+public:
+    static_assert(std::is_trivially_destructible_v<T>, "MappedPool requires trivially destructible nodes");
+
+    using Address = typename detail::PoolAddressOf<T>::type;
+    static_assert(sizeof(T) >= sizeof(Address));
+
+    static constexpr bool kMapped = true;
+    static constexpr Address kInvalidAddress = std::numeric_limits<Address>::max() >> 1;
+
+    using value_type = T;
+    using size_type = Address;
+    using difference_type = std::make_signed_t<Address>;
+
+    MappedPool() = default;
+
+    MappedPool(const MappedPool&) = delete;
+    MappedPool& operator=(const MappedPool&) = delete;
+
+    MappedPool(MappedPool&& right) noexcept {
+        Swap(right);
+    }
+
+    MappedPool& operator=(MappedPool&& right) noexcept {
+        if (this != &right) {
+            Close();
+            Swap(right);
+        }
+        return *this;
+    }
+
+    ~MappedPool() {
+        Close();
+    }
+
+    /*
+    * 映射文件，kReadWrite时文件不存在则创建
+    * 只读映射上不能分配或释放节点，调用时抛出std::logic_error
+    * 文件头中的根与大小只在Sync时写入，打开时检查它们落在已分配的节点范围内
+    */
+    void open(const std::string& path, MapMode mode) {
+        Close();
+        writable_ = mode == MapMode::kReadWrite;
+        OpenFile(path);
+        if (file_size_ == 0) {
+            if (!writable_) {
+                Close();
+                throw std::runtime_error("empty rbt pool file");
+            }
+            Remap(kInitCapacity);
+            InitHeader(kInitCapacity);
+            return;
+        }
+        if (file_size_ < sizeof(MappedPoolHeader)) {
+            Close();
+            throw std::runtime_error("invalid rbt pool file");
+        }
+        MapFile(file_size_);
+        const MappedPoolHeader* header = GetHeader();
+        if (std::memcmp(header->magic, MappedPoolHeader::kMagic, sizeof(header->magic)) != 0 ||
+            header->version != MappedPoolHeader::kVersion ||
+            header->node_size != sizeof(T) ||
+            header->address_size != sizeof(Address) ||
+            header->capacity > kInvalidAddress ||
+            header->next > header->capacity ||
+            BytesFor(header->capacity) > file_size_ ||
+            (header->root != kInvalidAddress && header->root >= header->next) ||
+            (header->free_head != kInvalidAddress && header->free_head >= header->next) ||
+            (header->root == kInvalidAddress) != (header->size == 0) ||
+            header->size > header->next) {
+            Close();
+            throw std::runtime_error("invalid rbt pool file");
+        }
+    }
+
+    /*
+    * 以capacity个节点的容量新建(覆盖)文件
+    */
+    void create(const std::string& path, uint64_t capacity) {
+        Close();
+        writable_ = true;
+        OpenFile(path, true);
+        capacity = capacity < kInitCapacity ? kInitCapacity : capacity;
+        if (capacity > kInvalidAddress) {
+            Close();
+            throw std::bad_alloc();
+        }
+        Remap(capacity);
+        InitHeader(capacity);
+    }
+
+    bool is_mapped() const noexcept {
+        return data_ != nullptr;
+    }
+
+    bool writable() const noexcept {
+        return writable_;
+    }
+
+    /*
+    * 清空所有节点，保留映射
+    */
+    void reset() noexcept {
+        if (data_ && writable_) {
+            MappedPoolHeader* header = GetHeader();
+            header->next = 0;
+            header->free_head = kInvalidAddress;
+            header->root = kInvalidAddress;
+            header->size = 0;
+        }
+    }
+
+    Address allocate() {
+        CheckWritable();
+        if (!data_) {
+            Remap(kInitCapacity);
+            InitHeader(kInitCapacity);
+        }
+        MappedPoolHeader* header = GetHeader();
+        if (header->free_head != kInvalidAddress) {
+            Address addr = static_cast<Address>(header->free_head);
+            Address next_free;
+            std::memcpy(&next_free, Slot(addr), sizeof(Address));
+            header->free_head = next_free;
+            return addr;
+        }
+        if (header->next == header->capacity) {
+            if (header->capacity >= kInvalidAddress) {
+                return kInvalidAddress;
+            }
+            uint64_t capacity = header->capacity * 2;
+            if (capacity > kInvalidAddress) {
+                capacity = kInvalidAddress;
+            }
+            Remap(capacity);
+            header = GetHeader();
+            header->capacity = capacity;
+        }
+        return static_cast<Address>(header->next++);
+    }
+
+    void deallocate(Address addr) {
+        CheckWritable();
+        MappedPoolHeader* header = GetHeader();
+        Address next_free = static_cast<Address>(header->free_head);
+        std::memcpy(Slot(addr), &next_free, sizeof(Address));
+        header->free_head = addr;
+    }
+
+    T* reference(Address addr) const noexcept {
+        if (!data_ || addr >= GetHeader()->next) {
+            return nullptr;
+        }
+        return reinterpret_cast<T*>(Slot(addr));
+    }
+
+    void dereference(T*) const noexcept {
+    }
+
+    Address root() const noexcept {
+        return data_ ? static_cast<Address>(GetHeader()->root) : kInvalidAddress;
+    }
+
+    uint64_t size() const noexcept {
+        return data_ ? GetHeader()->size : 0;
+    }
+
+    /*
+    * 记录树的根与大小，sync为true时同步写回文件
+    */
+    void Sync(Address root, uint64_t size, bool sync = false) noexcept {
+        if (!data_ || !writable_) {
+            return;
+        }
+        MappedPoolHeader* header = GetHeader();
+        header->root = root;
+        header->size = size;
+        if (sync && file_ != kNoFile) {
+#ifdef _WIN32
+            FlushViewOfFile(data_, 0);
+            FlushFileBuffers(file_);
+#else
+            msync(data_, mapped_size_, MS_SYNC);
+#endif
+        }
+    }
+
+private:
+    static constexpr Address kInitCapacity = kInvalidAddress < 1024 ? kInvalidAddress : 1024;
+
+#ifdef _WIN32
+    using FileHandle = HANDLE;
+    static inline const FileHandle kNoFile = INVALID_HANDLE_VALUE;
+#else
+    using FileHandle = int;
+    static constexpr FileHandle kNoFile = -1;
+#endif
+
+    static size_t BytesFor(uint64_t capacity) noexcept {
+        return sizeof(MappedPoolHeader) + static_cast<size_t>(capacity) * sizeof(T);
+    }
+
+    void CheckWritable() const {
+        if (!writable_) {
+            throw std::logic_error("rbt pool is mapped read-only");
+        }
+    }
+
+    MappedPoolHeader* GetHeader() const noexcept {
+        return reinterpret_cast<MappedPoolHeader*>(data_);
+    }
+
+    std::byte* Slot(Address addr) const noexcept {
+        return data_ + sizeof(MappedPoolHeader) + static_cast<size_t>(addr) * sizeof(T);
+    }
+
+    void InitHeader(uint64_t capacity) noexcept {
+        MappedPoolHeader* header = GetHeader();
+        std::memcpy(header->magic, MappedPoolHeader::kMagic, sizeof(header->magic));
+        header->version = MappedPoolHeader::kVersion;
+        header->node_size = sizeof(T);
+        header->address_size = sizeof(Address);
+        header->capacity = capacity;
+        header->next = 0;
+        header->free_head = kInvalidAddress;
+        header->root = kInvalidAddress;
+        header->size = 0;
+    }
+
+    /*
+    * 重新映射为可容纳capacity个节点的大小，匿名内存则拷贝到新的区域
+    */
+    void Remap(uint64_t capacity) {
+        size_t new_size = BytesFor(capacity);
+        if (file_ == kNoFile) {
+            auto* data = static_cast<std::byte*>(::operator new(new_size, std::align_val_t{ alignof(MappedPoolHeader) }));
+            if (data_) {
+                std::memcpy(data, data_, mapped_size_);
+                ::operator delete(data_, std::align_val_t{ alignof(MappedPoolHeader) });
+            }
+            data_ = data;
+            mapped_size_ = new_size;
+            return;
+        }
+        Unmap();
+        ResizeFile(new_size);
+        MapFile(new_size);
+    }
+
+    void OpenFile(const std::string& path, bool truncate = false) {
+#ifdef _WIN32
+        DWORD access = writable_ ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ;
+        DWORD disposition = !writable_ ? OPEN_EXISTING : truncate ? CREATE_ALWAYS : OPEN_ALWAYS;
+        file_ = CreateFileA(path.c_str(), access, FILE_SHARE_READ, nullptr, disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "open " + path);
+        }
+        LARGE_INTEGER size;
+        GetFileSizeEx(file_, &size);
+        file_size_ = static_cast<size_t>(size.QuadPart);
+#else
+        int flags = writable_ ? (O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0)) : O_RDONLY;
+        file_ = ::open(path.c_str(), flags, 0644);
+        if (file_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+        struct stat st;
+        if (fstat(file_, &st) != 0) {
+            int err = errno;
+            Close();
+            throw std::system_error(err, std::generic_category(), "fstat " + path);
+        }
+        file_size_ = static_cast<size_t>(st.st_size);
+#endif
+    }
+
+    void ResizeFile(size_t size) {
+#ifdef _WIN32
+        LARGE_INTEGER pos;
+        pos.QuadPart = static_cast<LONGLONG>(size);
+        if (!SetFilePointerEx(file_, pos, nullptr, FILE_BEGIN) || !SetEndOfFile(file_)) {
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "resize");
+        }
+#else
+        if (ftruncate(file_, static_cast<off_t>(size)) != 0) {
+            throw std::system_error(errno, std::generic_category(), "ftruncate");
+        }
+#endif
+        file_size_ = size;
+    }
+
+    void MapFile(size_t size) {
+#ifdef _WIN32
+        mapping_ = CreateFileMappingA(file_, nullptr, writable_ ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) {
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "CreateFileMapping");
+        }
+        void* data = MapViewOfFile(mapping_, writable_ ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+        if (!data) {
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "MapViewOfFile");
+        }
+#else
+        void* data = mmap(nullptr, size, writable_ ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, file_, 0);
+        if (data == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap");
+        }
+#endif
+        data_ = static_cast<std::byte*>(data);
+        mapped_size_ = size;
+    }
+
+    void Unmap() noexcept {
+        if (!data_) {
+            return;
+        }
+        if (file_ == kNoFile) {
+            ::operator delete(data_, std::align_val_t{ alignof(MappedPoolHeader) });
+        }
+        else {
+#ifdef _WIN32
+            UnmapViewOfFile(data_);
+            CloseHandle(mapping_);
+            mapping_ = nullptr;
+#else
+            munmap(data_, mapped_size_);
+#endif
+        }
+        data_ = nullptr;
+        mapped_size_ = 0;
+    }
+
+    void Close() noexcept {
+        Unmap();
+        if (file_ != kNoFile) {
+#ifdef _WIN32
+            CloseHandle(file_);
+#else
+            ::close(file_);
+#endif
+            file_ = kNoFile;
+        }
+        file_size_ = 0;
+        writable_ = true;
+    }
+
+    void Swap(MappedPool& right) noexcept {
+        std::swap(data_, right.data_);
+        std::swap(mapped_size_, right.mapped_size_);
+        std::swap(file_size_, right.file_size_);
+        std::swap(file_, right.file_);
+#ifdef _WIN32
+        std::swap(mapping_, right.mapping_);
+#endif
+        std::swap(writable_, right.writable_);
+    }
+
+private:
+    std::byte* data_ = nullptr;
+    size_t mapped_size_ = 0;
+    size_t file_size_ = 0;
+    FileHandle file_ = kNoFile;
+#ifdef _WIN32
+    HANDLE mapping_ = nullptr;
+#endif
+    bool writable_ = true;
+};
+
+} // namespace rbt
+
+#endif // RBT_MAPPED_POOL_HPP_
@@ -3,12 +3,136 @@
 
 #include <utility>
 #include <cassert>
+#include <cstdint>
 #include <array>
+#include <tuple>
+#include <memory>
+#include <iterator>
+#include <compare>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <bit>
+#include <initializer_list>
+#include <bitset>
+#include <limits>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include <future>
+#include <thread>
+#include <type_traits>
+#include <concepts>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
 
 #include <fpoo/memory_pool.hpp>
 
+#include <rbt/compare.hpp>
+#include <rbt/mapped_pool.hpp>
+#include <rbt/small_pool.hpp>
+#include <rbt/arena_pool.hpp>
+#include <rbt/aggregate.hpp>
+
 namespace rbt {
 
+namespace detail {
+
+inline void Prefetch(const void* address) noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+#if defined(_M_IX86) || defined(_M_X64)
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#elif defined(_M_ARM64)
+    __prefetch(address);
+#endif
+#else
+    __builtin_prefetch(address);
+#endif
+}
+
+/*
+* ڵۺֵΪNodeĻ࣬δʱǿջ࣬ռڵռ
+*/
+template <bool kEnable, class Count>
+class NodeCount {
+};
+
+template <class Count>
+class NodeCount<true, Count> {
+public:
+    Count GetCount() const noexcept {
+        return count_;
+    }
+
+    void SetCount(Count count) noexcept {
+        count_ = count;
+    }
+
+private:
+    Count count_ = 1;
+};
+
+template <bool kCount, class Monoid, class Count>
+class NodeAugment : public NodeCount<kCount, Count> {
+public:
+    using Aggregate = typename Monoid::Aggregate;
+
+    const Aggregate& GetAggregate() const noexcept {
+        return aggregate_;
+    }
+
+    void SetAggregate(Aggregate aggregate) {
+        aggregate_ = std::move(aggregate);
+    }
+
+private:
+    Aggregate aggregate_ = Monoid::Identity();
+};
+
+template <bool kCount, class Count>
+class NodeAugment<kCount, void, Count> : public NodeCount<kCount, Count> {
+};
+
+/*
+* Traits::NodeAddressĬ32λ
+*/
+template <class Traits, class = void>
+struct NodeAddressOf {
+    using type = uint32_t;
+};
+
+template <class Traits>
+struct NodeAddressOf<Traits, std::void_t<typename Traits::NodeAddress>> {
+    using type = typename Traits::NodeAddress;
+};
+
+/*
+* ڴ(ArenaPool)arenaͣڴΪvoid
+*/
+template <class Pool, class = void>
+struct ArenaOf {
+    using type = void;
+};
+
+template <class Pool>
+struct ArenaOf<Pool, std::void_t<typename Pool::arena_type>> {
+    using type = typename Pool::arena_type;
+};
+
+template <class Traits, class = void>
+struct MonoidOf {
+    using type = void;
+};
+
+template <class Traits>
+struct MonoidOf<Traits, std::void_t<typename Traits::Monoid>> {
+    using type = typename Traits::Monoid;
+};
+
+} // namespace detail
+
 template <class RbTreeT>
 class RbTreeUncheckedConstIterator {
 public:
@@ -22,15 +146,28 @@ public:
     using pointer = typename RbTreeT::const_pointer;
     using reference = const value_type&;
 
-    RbTreeUncheckedConstIterator(RbTreeT& rb_tree, NodeAddress node_address, IteratorStack&& stack) noexcept :
-        rb_tree_ { rb_tree },
-        node_address_ { node_address }, 
-        stack_{ std::move(stack) } {
-        
+    RbTreeUncheckedConstIterator() noexcept = default;
+
+    RbTreeUncheckedConstIterator(const RbTreeT* rb_tree, NodeAddress node_address, IteratorStack&& stack) noexcept :
+        stack_{ std::move(stack) },
+        node_address_{ node_address },
+        rb_tree_{ rb_tree },
+        epoch_{ rb_tree->epoch_ } {
+
+    }
+
+    /*
+    * ֻнڵַ·ڵһҪʱ
+    */
+    RbTreeUncheckedConstIterator(const RbTreeT* rb_tree, NodeAddress node_address) noexcept :
+        node_address_{ node_address },
+        rb_tree_{ rb_tree },
+        epoch_{ rb_tree->epoch_ - 1 } {
+
     }
 
     [[nodiscard]] reference operator*() const noexcept {
-        return node_address_->element;
+        return rb_tree_->GetValue(node_address_);
     }
 
     [[nodiscard]] pointer operator->() const noexcept {
@@ -38,24 +175,33 @@ public:
     }
 
     RbTreeUncheckedConstIterator& operator++() noexcept {
-        node_address_ = node_address_->next_;
+        revalidate();
+        node_address_ = rb_tree_->Next(stack_, node_address_);
         return *this;
     }
 
     RbTreeUncheckedConstIterator operator++(int) noexcept {
         RbTreeUncheckedConstIterator tmp = *this;
-        node_address_ = node_address_->next_;
+        ++*this;
         return tmp;
     }
 
     RbTreeUncheckedConstIterator& operator--() noexcept {
-        node_address_ = node_address_->prev_;
+        if (node_address_ == RbTreeT::kInvalidAddress) {
+            /* end()ǰĽڵ㣬·һƶʱ */
+            node_address_ = rb_tree_->rightmost_;
+            epoch_ = rb_tree_->epoch_ - 1;
+        }
+        else {
+            revalidate();
+            node_address_ = rb_tree_->Prev(stack_, node_address_);
+        }
         return *this;
     }
 
     RbTreeUncheckedConstIterator operator--(int) noexcept {
         RbTreeUncheckedConstIterator tmp = *this;
-        node_address_ = node_address_->prev_;
+        --*this;
         return tmp;
     }
 
@@ -63,10 +209,26 @@ public:
         return node_address_ == right.node_address_;
     }
 
+    /*
+    * ڵ֮޸Ĺʱǰڵkey·O(log n)ʲôҲ
+    * ++/--Զãǰڵ㱾ɾȻʧЧ
+    */
+    void revalidate() noexcept {
+        if (epoch_ != rb_tree_->epoch_) {
+            if (node_address_ != RbTreeT::kInvalidAddress) {
+                rb_tree_->PathTo(stack_, node_address_);
+            }
+            epoch_ = rb_tree_->epoch_;
+        }
+    }
+
+    /* ǰڵ·(ǰڵ)ϻ */
     IteratorStack stack_;
-    NodeAddress node_address_;
+    NodeAddress node_address_ = RbTreeT::kInvalidAddress;
 
-    RbTreeT& rb_tree_;
+    const RbTreeT* rb_tree_ = nullptr;
+    /* ȡ·ʱ޸ļ */
+    uint64_t epoch_ = 0;
 };
 
 template <class RbTreeT>
@@ -83,33 +245,32 @@ public:
     using Base::Base;
 
     [[nodiscard]] reference operator*() const noexcept {
-        //return node_address_->element;
+        return Base::operator*();
     }
 
     [[nodiscard]] pointer operator->() const noexcept {
-        return pointer_traits<pointer>::pointer_to(**this);
+        return std::pointer_traits<pointer>::pointer_to(**this);
     }
 
     RbTreeConstIterator& operator++() noexcept {
-        this->node_address_ = this->node_address_->next_;
+        Base::operator++();
         return *this;
     }
 
     RbTreeConstIterator operator++(int) noexcept {
         RbTreeConstIterator tmp = *this;
-        ++*this;
+        Base::operator++();
         return tmp;
     }
 
     RbTreeConstIterator& operator--() noexcept {
-        const auto new_ptr = this->node_address_->prev_;
-        this->node_address_ = new_ptr;
+        Base::operator--();
         return *this;
     }
 
     RbTreeConstIterator operator--(int) noexcept {
         RbTreeConstIterator tmp = *this;
-        --*this;
+        Base::operator--();
         return tmp;
     }
 
@@ -121,7 +282,7 @@ public:
 template <class RbTreeT>
 class RbTreeIterator : public RbTreeConstIterator<RbTreeT> {
 public:
-    using Base = RbTreeIterator<RbTreeT>;
+    using Base = RbTreeConstIterator<RbTreeT>;
     using iterator_category = std::bidirectional_iterator_tag;
 
     using value_type = typename RbTreeT::value_type;
@@ -131,11 +292,11 @@ public:
 
     using Base::Base;
 
-    _NODISCARD reference operator*() const noexcept {
+    [[nodiscard]] reference operator*() const noexcept {
         return const_cast<reference>(Base::operator*());
     }
 
-    _NODISCARD pointer operator->() const noexcept {
+    [[nodiscard]] pointer operator->() const noexcept {
         return std::pointer_traits<pointer>::pointer_to(**this);
     }
 
@@ -162,22 +323,402 @@ public:
     }
 };
 
+/*
+* ֻ¼ڵַλãʺϴ棬Я·
+* ڵ㲻ƶֻҪָڵδɾûеshrink_to_fit/compactɾڵȻЧ
+* һ++/--ʱkey·(O(log n)ظkeyʱԽǰԪ)ڶϱһƶ
+* ֮һ̯O(1)cursor·ƶʱ
+*/
+template <class RbTreeT>
+class RbTreeCursor {
+public:
+    using iterator_category = std::bidirectional_iterator_tag;
+
+    using NodeAddress = typename RbTreeT::NodeAddress;
+    using IteratorStack = typename RbTreeT::IteratorStack;
+
+    using value_type = typename RbTreeT::value_type;
+    using difference_type = typename RbTreeT::difference_type;
+    using pointer = typename RbTreeT::const_pointer;
+    using reference = const value_type&;
+
+    RbTreeCursor() noexcept = default;
+
+    RbTreeCursor(const RbTreeUncheckedConstIterator<RbTreeT>& iter) noexcept :
+        node_address_{ iter.node_address_ },
+        rb_tree_{ iter.rb_tree_ } {
+
+    }
+
+    RbTreeCursor(const RbTreeCursor& right) noexcept :
+        node_address_{ right.node_address_ },
+        rb_tree_{ right.rb_tree_ } {
+
+    }
+
+    RbTreeCursor(RbTreeCursor&&) noexcept = default;
+
+    RbTreeCursor& operator=(const RbTreeCursor& right) noexcept {
+        node_address_ = right.node_address_;
+        rb_tree_ = right.rb_tree_;
+        return *this;
+    }
+
+    RbTreeCursor& operator=(RbTreeCursor&&) noexcept = default;
+
+    [[nodiscard]] reference operator*() const noexcept {
+        return rb_tree_->GetValue(node_address_);
+    }
+
+    [[nodiscard]] pointer operator->() const noexcept {
+        return std::pointer_traits<pointer>::pointer_to(**this);
+    }
+
+    RbTreeCursor& operator++() {
+        auto& walker = Walker();
+        ++walker;
+        node_address_ = walker.node_address_;
+        return *this;
+    }
+
+    RbTreeCursor operator++(int) noexcept {
+        RbTreeCursor tmp = *this;
+        ++*this;
+        return tmp;
+    }
+
+    RbTreeCursor& operator--() {
+        auto& walker = Walker();
+        --walker;
+        node_address_ = walker.node_address_;
+        return *this;
+    }
+
+    RbTreeCursor operator--(int) noexcept {
+        RbTreeCursor tmp = *this;
+        --*this;
+        return tmp;
+    }
+
+    [[nodiscard]] bool operator==(const RbTreeCursor& right) const noexcept {
+        return node_address_ == right.node_address_;
+    }
+
+    NodeAddress node_address_ = RbTreeT::kInvalidAddress;
+
+    const RbTreeT* rb_tree_ = nullptr;
+
+private:
+    /*
+    * һƶµĵλñⲿı(ֱӸֵnode_address_)´ӵǰڵ㿪ʼ
+    * ¼޸ļ޸ĺһƶʱ·
+    */
+    RbTreeUncheckedConstIterator<RbTreeT>& Walker() {
+        if (!walker_) {
+            walker_ = std::make_unique<RbTreeUncheckedConstIterator<RbTreeT>>(rb_tree_, node_address_);
+        }
+        else if (walker_->node_address_ != node_address_ || walker_->rb_tree_ != rb_tree_) {
+            *walker_ = RbTreeUncheckedConstIterator<RbTreeT>{ rb_tree_, node_address_ };
+        }
+        return *walker_;
+    }
+
+    std::unique_ptr<RbTreeUncheckedConstIterator<RbTreeT>> walker_;
+};
+
+/*
+* ֻµľ̬RbTree::freeze()򹹽
+* keyĸEytzinger(BFS)˳ţʱÿķλÿǰ㣬Ԥȡ޷֧
+* ָеԪأ޸ĺʧЧҪfreeze
+*/
+template <class RbTreeT>
+class RbTreeFrozenIndex {
+public:
+    using NodeAddress = typename RbTreeT::NodeAddress;
+    using key_type = typename RbTreeT::key_type;
+    using value_type = typename RbTreeT::value_type;
+    using size_type = typename RbTreeT::size_type;
+    using difference_type = typename RbTreeT::difference_type;
+    using key_compare = typename RbTreeT::key_compare;
+
+    /*
+    * ±
+    */
+    class const_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+
+        using value_type = typename RbTreeT::value_type;
+        using difference_type = typename RbTreeT::difference_type;
+        using pointer = typename RbTreeT::const_pointer;
+        using reference = const value_type&;
+
+        const_iterator() noexcept = default;
+
+        const_iterator(const RbTreeFrozenIndex* index, size_type pos) noexcept :
+            pos_{ pos },
+            index_{ index } {
+
+        }
+
+        [[nodiscard]] reference operator*() const noexcept {
+            return index_->rb_tree_->GetValue(index_->nodes_[pos_]);
+        }
+
+        [[nodiscard]] pointer operator->() const noexcept {
+            return std::pointer_traits<pointer>::pointer_to(**this);
+        }
+
+        const_iterator& operator++() noexcept {
+            ++pos_;
+            return *this;
+        }
+
+        const_iterator operator++(int) noexcept {
+            const_iterator tmp = *this;
+            ++pos_;
+            return tmp;
+        }
+
+        const_iterator& operator--() noexcept {
+            --pos_;
+            return *this;
+        }
+
+        const_iterator operator--(int) noexcept {
+            const_iterator tmp = *this;
+            --pos_;
+            return tmp;
+        }
+
+        [[nodiscard]] bool operator==(const const_iterator& right) const noexcept {
+            return pos_ == right.pos_;
+        }
+
+        /*
+        * ӦԪصλ
+        */
+        [[nodiscard]] typename RbTreeT::cursor cursor() const noexcept {
+            typename RbTreeT::cursor cur;
+            cur.rb_tree_ = index_->rb_tree_;
+            cur.node_address_ = pos_ < index_->nodes_.size() ? index_->nodes_[pos_] : RbTreeT::kInvalidAddress;
+            return cur;
+        }
+
+    private:
+        size_type pos_ = 0;
+        const RbTreeFrozenIndex* index_ = nullptr;
+    };
+    using iterator = const_iterator;
+
+    RbTreeFrozenIndex() noexcept = default;
+
+    explicit RbTreeFrozenIndex(const RbTreeT& rb_tree) : rb_tree_{ &rb_tree }, epoch_{ rb_tree.epoch_ } {
+        nodes_.reserve(rb_tree.size());
+        auto [node_id, stack] = rb_tree.First();
+        for (; node_id != RbTreeT::kInvalidAddress; node_id = rb_tree.Next(stack, node_id)) {
+            nodes_.push_back(node_id);
+        }
+        if (nodes_.empty()) {
+            return;
+        }
+        /* ʽȫԪأranks_[k]ΪλkӦ± */
+        size_t count = nodes_.size();
+        ranks_.resize(count + 1);
+        size_type rank = 0;
+        std::vector<size_t> stack_slots;
+        size_t slot = 1;
+        while (slot <= count || !stack_slots.empty()) {
+            if (slot <= count) {
+                stack_slots.push_back(slot);
+                slot *= 2;
+            }
+            else {
+                slot = stack_slots.back(); stack_slots.pop_back();
+                ranks_[slot] = rank++;
+                slot = slot * 2 + 1;
+            }
+        }
+        /* λ0ңһkeyռλ */
+        keys_.reserve(count + 1);
+        keys_.push_back(GetKey(0));
+        for (size_t k = 1; k <= count; ++k) {
+            keys_.push_back(GetKey(ranks_[k]));
+        }
+    }
+
+    [[nodiscard]] size_type size() const noexcept {
+        return static_cast<size_type>(nodes_.size());
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return nodes_.empty();
+    }
+
+    /*
+    * freeze֮Ƿδ޸
+    */
+    [[nodiscard]] bool valid() const noexcept {
+        return rb_tree_ && epoch_ == rb_tree_->epoch_;
+    }
+
+    const_iterator begin() const noexcept {
+        return const_iterator{ this, 0 };
+    }
+
+    const_iterator end() const noexcept {
+        return const_iterator{ this, size() };
+    }
+
+    const_iterator find(const key_type& key) const {
+        return FindImpl(key);
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    const_iterator find(const K& x) const {
+        return FindImpl(x);
+    }
+
+    bool contains(const key_type& key) const {
+        return FindImpl(key) != end();
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    bool contains(const K& x) const {
+        return FindImpl(x) != end();
+    }
+
+    const_iterator lower_bound(const key_type& key) const {
+        return const_iterator{ this, Search<false>(key) };
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    const_iterator lower_bound(const K& x) const {
+        return const_iterator{ this, Search<false>(x) };
+    }
+
+    const_iterator upper_bound(const key_type& key) const {
+        return const_iterator{ this, Search<true>(key) };
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    const_iterator upper_bound(const K& x) const {
+        return const_iterator{ this, Search<true>(x) };
+    }
+
+private:
+    /* ԤȡkĵkPrefetchLevelskeys_ռԼһcache line */
+    static constexpr size_t kPrefetchLevels = sizeof(key_type) < 64 ? std::bit_width(64 / sizeof(key_type)) - 1 : 0;
+
+    const key_type& GetKey(size_type rank) const noexcept {
+        return rb_tree_->GetKey(nodes_[rank]);
+    }
+
+    /*
+    * keys_еĸȽϣȷǷǰĽڵ
+    */
+    template <class K>
+    const_iterator FindImpl(const K& key) const {
+        size_t slot = SearchSlot<false>(key);
+        if (slot == 0 || RbTreeT::CompareKey(key, keys_[slot]) != 0) {
+            return end();
+        }
+        return const_iterator{ this, ranks_[slot] };
+    }
+
+    /*
+    * һС(kUpperʱ)key±꣬ʱsize()
+    */
+    template <bool kUpper, class K>
+    size_type Search(const K& key) const {
+        size_t slot = SearchSlot<kUpper>(key);
+        return slot == 0 ? size() : ranks_[slot];
+    }
+
+    /*
+    * ڵĲλʱ0
+    * ÿ㰴ȽϽ/Һӣ±Ȼ·
+    * һתλüΪȥĩβ1()Լϵһ0
+    */
+    template <bool kUpper, class K>
+    size_t SearchSlot(const K& key) const {
+        assert(valid() || empty());
+        size_t count = nodes_.size();
+        size_t k = 1;
+        while (k <= count) {
+            if constexpr (kPrefetchLevels > 0) {
+                size_t ahead = k << kPrefetchLevels;
+                if (ahead <= count) {
+                    detail::Prefetch(keys_.data() + ahead);
+                }
+            }
+            std::strong_ordering ordering = RbTreeT::CompareKey(keys_[k], key);
+            bool is_right = kUpper ? ordering <= 0 : ordering < 0;
+            k = 2 * k + is_right;
+        }
+        return k >> (std::countr_one(k) + 1);
+    }
+
+    std::vector<key_type> keys_;
+    std::vector<size_type> ranks_;
+    /* Ľڵַ */
+    std::vector<NodeAddress> nodes_;
+    const RbTreeT* rb_tree_ = nullptr;
+    uint64_t epoch_ = 0;
+};
+
 template <class Traits>
 class RbTree {
 protected:
     friend class RbTreeUncheckedConstIterator<RbTree<Traits>>;
+    friend class RbTreeCursor<RbTree<Traits>>;
+    friend class RbTreeFrozenIndex<RbTree<Traits>>;
 
     using Key = Traits::Key;
     using Value = Traits::Value;
     using Element = Traits::Element;
 
-    using NodeAddress = uint32_t;
-    using Color = uint32_t;
+    /* Ƿظkey(multiset/multimap) */
+    static constexpr bool kMulti = Traits::kMulti;
+
+    /* ǷڽڵάС֧nth/rank/count_rangeδʱڵ㲻 */
+    static constexpr bool kOrderStatistic = [] {
+        if constexpr (requires { Traits::kOrderStatistic; }) {
+            return Traits::kOrderStatistic;
+        }
+        else {
+            return false;
+        }
+    }();
+
+    /*
+    * ѡۺ(aggregate.hpp)Traits::Monoidṩ
+    *   Aggregate͡Identity()FromValue(const Value&)Combine(a, b)
+    * Combineɣϲɽ
+    */
+    using Monoid = typename detail::MonoidOf<Traits>::type;
+    static constexpr bool kAggregate = !std::is_void_v<Monoid>;
+
+    /*
+    * ڵַĿTraits::NodeAddress(uint16_t/uint32_t/uint64_tĬuint32_t)
+    * λøɫ16λʱÿڵֻռ4ֽڣ64λʱɳ2^31ڵ
+    */
+    using NodeAddress = typename detail::NodeAddressOf<Traits>::type;
+    static_assert(std::is_same_v<NodeAddress, uint16_t> || std::is_same_v<NodeAddress, uint32_t> || std::is_same_v<NodeAddress, uint64_t>,
+        "NodeAddress must be uint16_t, uint32_t or uint64_t");
+    /* left_ͬͲܹһλԪ */
+    using Color = NodeAddress;
 
     static constexpr Color kBlack = 0x0;
     static constexpr Color kRed = 0x1;
-    static constexpr NodeAddress kMaxAddress = 0x7ffffffe;
-    static constexpr NodeAddress kInvalidAddress = 0x7fffffff;
+    static constexpr NodeAddress kInvalidAddress = std::numeric_limits<NodeAddress>::max() >> 1;
+    static constexpr NodeAddress kMaxAddress = kInvalidAddress - 1;
+    /*
+    * ĸ߶Ȳ2log(n + 1)n < 2^(bits - 1)
+    * ǶkMaxHeightַ·16λ60ֽڣ32λ248ֽڣ64λ1008ֽ
+    * 64λַĵԼ1KBֻнڵܳ2^31ʱֵʹãλʱӦʹcursor
+    */
+    static constexpr size_t kMaxHeight = 2 * (sizeof(NodeAddress) * 8 - 1);
 
     class IteratorStack {
     public:
@@ -185,6 +726,10 @@ protected:
             return stack_[cur_pos_ - 1];
         }
 
+        const NodeAddress& front() const noexcept {
+            return stack_[cur_pos_ - 1];
+        }
+
         constexpr void push_back(const NodeAddress& value) {
             stack_[cur_pos_++] = value;
         }
@@ -197,23 +742,48 @@ protected:
             cur_pos_ = 0;
         }
 
-        bool empty() {
+        bool empty() const {
             return cur_pos_ == 0;
         }
 
+        size_t size() const noexcept {
+            return cur_pos_;
+        }
+
+        /* ֻڽضϵĳһ */
+        void resize(size_t size) noexcept {
+            assert(size <= cur_pos_);
+            cur_pos_ = static_cast<uint32_t>(size);
+        }
+
+        NodeAddress& operator[](size_t pos) noexcept {
+            return stack_[pos];
+        }
+
+        const NodeAddress& operator[](size_t pos) const noexcept {
+            return stack_[pos];
+        }
+
     private:
-        std::array<NodeAddress, 62> stack_;
+        std::array<NodeAddress, kMaxHeight> stack_;
         uint32_t cur_pos_ = 0;
     };
     //using IteratorStack = std::vector<NodeAddress>;
 
 
-    class Node {
+    class Node : public detail::NodeAugment<kOrderStatistic, Monoid, NodeAddress> {
     public:
-        Node() : element_{} {
+        /* ڴȡõַ(MappedPool) */
+        using Address = NodeAddress;
+
+        template <class... Args>
+        explicit Node(Args&&... args) : element_(std::forward<Args>(args)...) {
             color_ = kBlack;
             left_ = kInvalidAddress;
             right_ = kInvalidAddress;
+            if constexpr (kAggregate) {
+                this->SetAggregate(Monoid::FromValue(Traits::GetValue(element_)));
+            }
         }
         //~Node() = default;
 
@@ -245,6 +815,10 @@ protected:
             return element_;
         }
 
+        const Key& GetKey() {
+            return Traits::GetKey(element_);
+        }
+
     private:
         struct {
             Color color_ : 1;
@@ -254,28 +828,37 @@ protected:
         Element element_;
 
     };
-    using AllocatorType = fpoo::CompactMemoryPool<Node>;
+    using AllocatorType = typename Traits::template Pool<Node>;
+
+    /* ڴǷΪļӳ(MappedPool)ʱСҲļ */
+    static constexpr bool kMapped = requires { AllocatorType::kMapped; };
+    static_assert(!kMapped || IsBitwisePersistable<Element>::value, "MappedPool requires trivially copyable elements");
+    /* ڴǷɶ(ArenaPool)ʱڵ黹 */
+    static constexpr bool kShared = requires { AllocatorType::kShared; };
 
 public:
     using key_type = Key;
     using value_type = Value;
-    using size_type = uint32_t;
-    using difference_type = int32_t;
+    using size_type = std::conditional_t<(sizeof(NodeAddress) > sizeof(uint32_t)), uint64_t, uint32_t>;
+    using difference_type = std::make_signed_t<size_type>;
 
     using key_compare = typename Traits::KeyCompare;
     using value_compare = typename Traits::ValueCompare;
 
     using allocator_type = AllocatorType;
+    using arena_type = typename detail::ArenaOf<AllocatorType>::type;
 
     using reference = value_type&;
     using const_reference = const value_type&;
-    using pointer = std::allocator_traits<AllocatorType>::pointer;
-    using const_pointer = std::allocator_traits<AllocatorType>::const_pointer;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
 
     using iterator = RbTreeIterator<RbTree<Traits>>;
     using const_iterator = RbTreeConstIterator<RbTree<Traits>>;
     using reverse_iterator = std::reverse_iterator<iterator>;
     using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using cursor = RbTreeCursor<RbTree<Traits>>;
+    using frozen_index = RbTreeFrozenIndex<RbTree<Traits>>;
 
     //using node_type = typename Traits::NodeType;
 
@@ -283,10 +866,245 @@ public:
     RbTree() {
     }
 
+    template <class InputIt>
+    RbTree(InputIt first, InputIt last) {
+        std::vector<value_type> values(first, last);
+        /* value_typeδؿɸֵ(mappair<const Key, T>)˶ָ */
+        std::vector<value_type*> sorted(values.size());
+        std::transform(values.begin(), values.end(), sorted.begin(), [](value_type& value) { return &value; });
+        auto less = [](const value_type* a, const value_type* b) {
+            return value_compare{}(*a, *b);
+        };
+        if (!std::is_sorted(sorted.begin(), sorted.end(), less)) {
+            /* ȶȥʱȳֵԪأinsertһ */
+            std::stable_sort(sorted.begin(), sorted.end(), less);
+        }
+        auto new_end = sorted.end();
+        if constexpr (!kMulti) {
+            new_end = std::unique(sorted.begin(), sorted.end(), [&](const value_type* a, const value_type* b) {
+                return !less(a, b);
+            });
+        }
+        BuildSorted(static_cast<size_type>(new_end - sorted.begin()), [&](size_type i) -> value_type&& {
+            return std::move(*sorted[i]);
+        });
+    }
+
+    RbTree(std::initializer_list<value_type> init) : RbTree(init.begin(), init.end()) {
+    }
+
+    /*
+    * ⲿarenaϣͬһarenaĿ
+    */
+    template <class Arena>
+        requires kShared && std::same_as<Arena, arena_type>
+    explicit RbTree(Arena& arena) : allocator_(&arena) {
+    }
+
+private:
+    explicit RbTree(AllocatorType&& pool) noexcept : allocator_(std::move(pool)) {
+    }
+
+public:
+
+    /*
+    * ȡԪغƽ⹹O(n)
+    */
+    RbTree(const RbTree& right) : allocator_(right.NewPool()) {
+        std::vector<const value_type*> values;
+        values.reserve(right.size_);
+        for (auto& value : right) {
+            values.push_back(&value);
+        }
+        BuildSorted(static_cast<size_type>(values.size()), [&](size_type i) -> const value_type& {
+            return *values[i];
+        });
+    }
+
+    RbTree(RbTree&& right) noexcept :
+        allocator_(std::move(right.allocator_)), root_(right.root_), leftmost_(right.leftmost_), rightmost_(right.rightmost_), size_(right.size_) {
+        right.ResetPool();
+        right.root_ = kInvalidAddress;
+        right.leftmost_ = kInvalidAddress;
+        right.rightmost_ = kInvalidAddress;
+        right.size_ = 0;
+        ++right.epoch_;
+        right.compact_.reset();
+    }
+
+    ~RbTree() noexcept {
+        SyncPool();
+        DestroyElements();
+    }
+
+    RbTree& operator=(const RbTree& right) {
+        if (this != &right) {
+            RbTree copy{ right };
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    RbTree& operator=(RbTree&& right) noexcept {
+        if (this != &right) {
+            SyncPool();
+            DestroyElements();
+            allocator_ = std::move(right.allocator_);
+            root_ = right.root_;
+            leftmost_ = right.leftmost_;
+            rightmost_ = right.rightmost_;
+            size_ = right.size_;
+            right.ResetPool();
+            right.root_ = kInvalidAddress;
+            right.leftmost_ = kInvalidAddress;
+            right.rightmost_ = kInvalidAddress;
+            right.size_ = 0;
+            ++right.epoch_;
+            right.compact_.reset();
+            ++epoch_;
+            compact_.reset();
+        }
+        return *this;
+    }
+
 public:
 
+    /*
+    * 黹ڵ㣬ԪغֱӶڴأпһͷ
+    * Ԫؿƽʱκνڵ㣬ֻ
+    */
     void clear() noexcept {
+        DestroyElements();
+        root_ = kInvalidAddress;
+        leftmost_ = kInvalidAddress;
+        rightmost_ = kInvalidAddress;
+        size_ = 0;
+        ResetPool();
+        ++epoch_;
+        compact_.reset();
+    }
+
+    /*
+    * ԪǨƵµڴвͷžɳأɾڹ黹ڴ
+    * ½ڵ㰴±ţĽڵڴ
+    * Ǩڼ¾ڴͬʱڣеʧЧ
+    * ļӳarenaڴزǨ
+    */
+    void shrink_to_fit() {
+        if constexpr (kMapped || kShared) {
+            return;
+        }
+        compact_.reset();
+        if (root_ == kInvalidAddress) {
+            ResetPool();
+            ++epoch_;
+            return;
+        }
+        std::vector<NodeAddress> nodes;
+        nodes.reserve(size_);
+        auto [node_id, stack] = First();
+        for (; node_id != kInvalidAddress; node_id = Next(stack, node_id)) {
+            nodes.push_back(node_id);
+        }
+        RbTree compacted;
+        compacted.BuildSorted(static_cast<size_type>(nodes.size()), [&](size_type i) -> decltype(auto) {
+            return std::move_if_noexcept(GetValue(nodes[i]));
+        });
+        *this = std::move(compacted);
+    }
+
+    /*
+    * ÿεǨbudgetԪأtrueʾ
+    * ԪذƵݴУڵһ£ȫɺ滻ͷžɳ
+    * Կȡκ޸Ķʹδɵϲ´εʱ¿ʼ
+    * ļӳarenaڴزǨƣֱӷtrue
+    */
+    bool compact(size_type budget) {
+        if constexpr (kMapped || kShared) {
+            return true;
+        }
+        if (root_ == kInvalidAddress) {
+            compact_.reset();
+            ResetPool();
+            ++epoch_;
+            return true;
+        }
+        if (!compact_ || compact_->epoch != epoch_) {
+            compact_ = std::make_unique<CompactState>();
+            std::tie(compact_->node_id, compact_->stack) = First();
+            compact_->epoch = epoch_;
+        }
+        CompactState& state = *compact_;
+        for (; budget > 0 && state.node_id != kInvalidAddress; --budget) {
+            state.staging.InsertSortedStep(state.staging_stack, state.staging_max_id, std::as_const(GetValue(state.node_id)));
+            state.node_id = Next(state.stack, state.node_id);
+        }
+        if (state.node_id != kInvalidAddress) {
+            return false;
+        }
+        RbTree compacted = std::move(state.staging);
+        *this = std::move(compacted);
+        return true;
+    }
+
+    /*
+    * дpathʹMappedPoolͨopen_mmapֱӳ䣬ؽ
+    * ڵ㰴±źţԪƽ
+    */
+    void save(const std::string& path) const {
+        static_assert(IsBitwisePersistable<Element>::value, "save requires trivially copyable elements");
+        MappedPool<Node> image;
+        image.create(path, size_);
+        NodeAddress image_root = kInvalidAddress;
+        if (root_ != kInvalidAddress) {
+            /* ˳µıţʱȷ */
+            std::vector<NodeAddress> queue;
+            queue.reserve(size_);
+            queue.push_back(root_);
+            for (size_t i = 0; i < queue.size(); ++i) {
+                Node* node = allocator_.reference(queue[i]);
+                NodeAddress image_id = image.allocate();
+                Node* image_node = image.reference(image_id);
+                std::memcpy(static_cast<void*>(image_node), node, sizeof(Node));
+                if (node->GetLeft() != kInvalidAddress) {
+                    image_node->SetLeft(static_cast<NodeAddress>(queue.size()));
+                    queue.push_back(node->GetLeft());
+                }
+                if (node->GetRight() != kInvalidAddress) {
+                    image_node->SetRight(static_cast<NodeAddress>(queue.size()));
+                    queue.push_back(node->GetRight());
+                }
+                allocator_.dereference(node);
+            }
+            image_root = 0;
+        }
+        image.Sync(image_root, size_, true);
+    }
+
+    /*
+    * ֱpathļӳУԭԪر
+    * kReadOnlyֻܲ롢ɾ޸׳std::logic_error
+    * kReadWrite޸Ļдļ(ļʱ)Сflushʱдļͷ
+    */
+    void open_mmap(const std::string& path, MapMode mode = MapMode::kReadOnly) requires kMapped {
+        DestroyElements();
+        root_ = kInvalidAddress;
+        leftmost_ = kInvalidAddress;
+        rightmost_ = kInvalidAddress;
+        size_ = 0;
+        ++epoch_;
+        compact_.reset();
+        allocator_.open(path, mode);
+        root_ = allocator_.root();
+        size_ = static_cast<size_type>(allocator_.size());
+        ResetBounds();
+    }
 
+    /*
+    * Сдӳļͬ
+    */
+    void flush() requires kMapped {
+        allocator_.Sync(root_, size_, true);
     }
 
     [[nodiscard]] size_type size() const noexcept {
@@ -320,7 +1138,7 @@ public:
         if (ordering != 0) {
             return end();
         }
-        return iterator{ *this, node_addr, std::move(stack) };
+        return iterator{ this, node_addr, std::move(stack) };
     }
 
     const_iterator find(const Key& key) const {
@@ -329,7 +1147,7 @@ public:
         if (ordering != 0) {
             return end();
         }
-        return const_iterator{ *this, node_addr, std::move(stack) };
+        return const_iterator{ this, node_addr, std::move(stack) };
     }
 
     template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
@@ -339,7 +1157,7 @@ public:
         if (ordering != 0) {
             return end();
         }
-        return iterator{ *this, node_addr, std::move(stack) };
+        return iterator{ this, node_addr, std::move(stack) };
     }
 
     template<class K, class Kc = key_compare, class = typename Kc::is_transparent>
@@ -349,772 +1167,2773 @@ public:
         if (ordering != 0) {
             return end();
         }
-        return const_iterator{ *this, node_addr, std::move(stack) };
+        return const_iterator{ this, node_addr, std::move(stack) };
     }
 
     template<class K> bool contains(const K& x) const {
         return find(x) != end();
     }
 
-    std::pair<iterator, bool> insert(const value_type& value) {
-        auto node_addr = allocator_.allocate();
-        if (node_addr > kMaxAddress) {
-            throw std::bad_alloc();     // "The maximum node limit of the tree has been reached."
+    size_type count(const Key& key) const {
+        if constexpr (kMulti) {
+            auto [first, last] = equal_range(key);
+            return static_cast<size_type>(std::distance(first, last));
+        }
+        else {
+            return contains(key) ? 1 : 0;
         }
+    }
 
-        Node* node = allocator_.reference(node_addr);
-        std::construct_at<Node>(node);
-        node->GetElement() = value;
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    size_type count(const K& x) const {
+        if constexpr (kMulti) {
+            auto [first, last] = equal_range(x);
+            return static_cast<size_type>(std::distance(first, last));
+        }
+        else {
+            return contains(x) ? 1 : 0;
+        }
+    }
 
+    /*
+    * һ½صĵЯ·ֱ++/--
+    */
+    iterator lower_bound(const Key& key) {
         IteratorStack stack;
-        auto success = Insert(stack, node_addr);
-        if (!success) {
-            std::destroy_at<Node>(node);
-            allocator_.dereference(node);
-            allocator_.deallocate(node_addr);
+        NodeAddress node_id = LowerBound(stack, key);
+        return iterator{ this, node_id, std::move(stack) };
+    }
 
-            node_addr = stack.front();
-            stack.pop_back();
-            return std::pair{ iterator{ *this, node_addr, std::move(stack) }, false };
-        }
-        ++size_;
-        allocator_.dereference(node);
-        /* ʹ䱣֤ջı */
-        InsertFixup(stack, node_addr);
-        return std::pair{ iterator{ *this, node_addr, std::move(stack) }, true };
+    const_iterator lower_bound(const Key& key) const {
+        IteratorStack stack;
+        NodeAddress node_id = LowerBound(stack, key);
+        return const_iterator{ this, node_id, std::move(stack) };
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    iterator lower_bound(const K& x) {
+        IteratorStack stack;
+        NodeAddress node_id = LowerBound(stack, x);
+        return iterator{ this, node_id, std::move(stack) };
     }
 
-    //std::pair<iterator, bool> insert(value_type&& value) {
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    const_iterator lower_bound(const K& x) const {
+        IteratorStack stack;
+        NodeAddress node_id = LowerBound(stack, x);
+        return const_iterator{ this, node_id, std::move(stack) };
+    }
 
-    //}
+    iterator upper_bound(const Key& key) {
+        IteratorStack stack;
+        NodeAddress node_id = UpperBound(stack, key);
+        return iterator{ this, node_id, std::move(stack) };
+    }
 
-    size_type erase(const key_type& key) {
+    const_iterator upper_bound(const Key& key) const {
         IteratorStack stack;
-        auto [del_node_id, ordering] = Find(stack, key);
-        if (del_node_id == kInvalidAddress) return 0;
-        auto node = Delete(stack, del_node_id);
-        if (node != kInvalidAddress) {
-            return 1;
-        }
-        return 0;
+        NodeAddress node_id = UpperBound(stack, key);
+        return const_iterator{ this, node_id, std::move(stack) };
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    iterator upper_bound(const K& x) {
+        IteratorStack stack;
+        NodeAddress node_id = UpperBound(stack, x);
+        return iterator{ this, node_id, std::move(stack) };
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    const_iterator upper_bound(const K& x) const {
+        IteratorStack stack;
+        NodeAddress node_id = UpperBound(stack, x);
+        return const_iterator{ this, node_id, std::move(stack) };
+    }
+
+    std::pair<iterator, iterator> equal_range(const Key& key) {
+        auto first = lower_bound(key);
+        return std::pair{ first, EqualRangeEnd(first, key) };
+    }
+
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
+        auto first = lower_bound(key);
+        return std::pair{ first, EqualRangeEnd(first, key) };
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    std::pair<iterator, iterator> equal_range(const K& x) {
+        auto first = lower_bound(x);
+        return std::pair{ first, EqualRangeEnd(first, x) };
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    std::pair<const_iterator, const_iterator> equal_range(const K& x) const {
+        auto first = lower_bound(x);
+        return std::pair{ first, EqualRangeEnd(first, x) };
     }
 
     /*
-    * iterator
+    * kС(0ʼ)Ԫأk >= size()ʱend()kOrderStatistic
     */
-    iterator begin() noexcept {
-        auto [node_addr, stack] = First();
-        return iterator{ *this, node_addr, std::move(stack) };
+    iterator nth(size_type k) requires kOrderStatistic {
+        IteratorStack stack;
+        NodeAddress node_id = Nth(stack, k);
+        return iterator{ this, node_id, std::move(stack) };
     }
 
-    const_iterator begin() const noexcept {
-        auto [node_addr, stack] = First();
-        return const_iterator{ *this, node_addr, std::move(stack) };
+    const_iterator nth(size_type k) const requires kOrderStatistic {
+        IteratorStack stack;
+        NodeAddress node_id = Nth(stack, k);
+        return const_iterator{ this, node_id, std::move(stack) };
     }
 
-    iterator end() noexcept {
-        return iterator{ *this, kInvalidAddress, IteratorStack{} };
+    /*
+    * СkeyԪظlower_bound(key)±
+    */
+    size_type rank(const Key& key) const requires kOrderStatistic {
+        return Rank(key);
     }
 
-    const_iterator end() const noexcept {
-        return const_iterator{ *this, kInvalidAddress,  IteratorStack{} };
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    size_type rank(const K& x) const requires kOrderStatistic {
+        return Rank(x);
     }
 
-    [[nodiscard]] reverse_iterator rbegin() noexcept {
-        return reverse_iterator(end());
+    /*
+    * [lo, hi)еԪظ
+    */
+    size_type count_range(const Key& lo, const Key& hi) const requires kOrderStatistic {
+        size_type lo_rank = Rank(lo), hi_rank = Rank(hi);
+        return hi_rank > lo_rank ? hi_rank - lo_rank : 0;
     }
 
-    [[nodiscard]] const_reverse_iterator rbegin() const noexcept {
-        return const_reverse_iterator(end());
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    size_type count_range(const K& lo, const K& hi) const requires kOrderStatistic {
+        size_type lo_rank = Rank(lo), hi_rank = Rank(hi);
+        return hi_rank > lo_rank ? hi_rank - lo_rank : 0;
     }
 
-    [[nodiscard]] reverse_iterator rend() noexcept {
-        return reverse_iterator(begin());
+    /*
+    * [lo, hi)ֵCombineĽO(log n)ṩTraits::Monoid
+    */
+    auto reduce(const Key& lo, const Key& hi) const requires kAggregate {
+        return Reduce(lo, hi);
     }
 
-    [[nodiscard]] const_reverse_iterator rend() const noexcept {
-        return const_reverse_iterator(begin());
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    auto reduce(const K& lo, const K& hi) const requires kAggregate {
+        return Reduce(lo, hi);
     }
 
-    [[nodiscard]] const_iterator cbegin() const noexcept {
-        return begin();
+    /*
+    * ľۺֵO(1)
+    */
+    auto reduce() const requires kAggregate {
+        return GetAggregate(root_);
     }
 
-    [[nodiscard]] const_iterator cend() const noexcept {
-        return end();
+    /*
+    * ͨfԭ޸posֵάۺֵføıkey
+    * þۺʱɵֱ޸ֵ¾ۺֵӦʹô˽ӿ
+    */
+    template <class F>
+    void modify(const_iterator pos, F&& f) requires kAggregate {
+        CheckWritable();
+        std::forward<F>(f)(GetValue(pos.node_address_));
+        RefreshAggregate(pos);
     }
 
-    [[nodiscard]] const_reverse_iterator crbegin() const noexcept {
-        return rbegin();
+    /*
+    * ң[first, last)Ϊkey(ɶα)
+    * outдָԪصָ룬ʱдnullptr
+    */
+    template <class ForwardIt, class OutputIt>
+    OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) {
+        FindBatch(first, last, [&](NodeAddress node_id) {
+            *out++ = node_id == kInvalidAddress ? nullptr : &GetValue(node_id);
+        });
+        return out;
     }
 
-    [[nodiscard]] const_reverse_iterator crend() const noexcept {
-        return rend();
+    template <class ForwardIt, class OutputIt>
+    OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+        FindBatch(first, last, [&](NodeAddress node_id) {
+            *out++ = node_id == kInvalidAddress ? nullptr : static_cast<const_pointer>(&GetValue(node_id));
+        });
+        return out;
     }
 
-protected:
-    NodeAddress Find(const Key& key) {
-        IteratorStack stack;
-        auto [node_addr, ordering] = Find(stack, key);
-        return ordering == 0 ? node_addr : kInvalidAddress;
+    template <class ForwardIt, class OutputIt>
+    OutputIt contains_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+        FindBatch(first, last, [&](NodeAddress node_id) {
+            *out++ = node_id != kInvalidAddress;
+        });
+        return out;
     }
 
     /*
-    * ֤
+    * Ȳٷ䣬keyѴʱڵ㣬Ҳ´value
     */
-    bool VerifyTree() {
-        Node* node = allocator_.reference(root_);
-        if (!node) return true;
-        bool correct = false;
-        do {
-            if (node->GetColor() != kBlack) break;
-            typename AllocatorType::difference_type high = 1;
-            while (node->GetLeft() != kInvalidAddress) {
-                NodeAddress node_id = node->GetLeft();
-                allocator_.dereference(node);
-                node = allocator_.reference(node_id);
-                /* ɫڵ㲻ʾ߶ */
-                if (node->GetColor() == kBlack) {
-                    high++;
-                }
-            }
-            correct = CheckPath(kInvalidAddress, root_, 0, high);
-        } while (false);
-        allocator_.dereference(node);
-        return correct;
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return EmplaceKey(Traits::GetKey(value), value);
     }
 
+    std::pair<iterator, bool> insert(value_type&& value) {
+        return EmplaceKey(Traits::GetKey(value), std::move(value));
+    }
 
-    std::tuple<NodeAddress, IteratorStack> First() const noexcept {
-        IteratorStack stack;
-        NodeAddress cur_id = root_;
-        if (cur_id == kInvalidAddress) {
-            return kInvalidAddress;
+    /*
+    * ֱȡkeyʱ(Traits::ExtractKey)ȲңԪֻڽڵԭλһ
+    * ֻȹڵٲ
+    */
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        if constexpr (requires { Traits::ExtractKey(args...); }) {
+            return EmplaceKey(Traits::ExtractKey(args...), std::forward<Args>(args)...);
         }
-        Node* cur = allocator_.reference(cur_id);
-        while (cur.GetLeft() != kInvalidAddress) {
-            stack.push_back(cur_id);
-            cur_id = cur.GetLeft();
-            allocator_.dereference(cur);
-            cur = allocator_.reference(cur_id);
+        else {
+            return EmplaceNode(std::forward<Args>(args)...);
         }
-        allocator_.dereference(cur);
-        return std::tuple{ cur_id, std::move(stack) };
     }
 
-    std::tuple<NodeAddress, IteratorStack> Last() const noexcept {
-        IteratorStack stack;
-        NodeAddress cur_id = root_;
-        if (cur_id == kInvalidAddress) {
-            return kInvalidAddress;
+    template <class... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args) {
+        DropExpired();
+        if constexpr (requires { Traits::ExtractKey(args...); }) {
+            IteratorStack stack = HintPath(hint);
+            return EmplaceNear(stack, Traits::ExtractKey(args...), std::forward<Args>(args)...).first;
         }
-        Node* cur = allocator_.reference(cur_id);
-        while (cur.GetRight() != kInvalidAddress) {
-            stack.push_back(cur_id);
-            cur_id = cur.GetRight();
-            allocator_.dereference(cur);
-            cur = allocator_.reference(cur_id);
+        else {
+            return EmplaceNode(std::forward<Args>(args)...).first;
         }
-        allocator_.dereference(cur);
-        return std::tuple{ cur_id, std::move(stack) };
     }
 
-private:
     /*
-    * 滻ºӽڵ
+    * ϸ(value_compare)ظ滻еȫԪأO(n)
+    * ظkeyʱֻҪǽԪرԭ˳
+    * ʺϴӳ־ûпؽ
     */
-    void ReplaceChild(Node* node, NodeAddress node_id, NodeAddress new_node_id) {
-        if (node->GetLeft() == node_id) {
-            node->SetLeft(new_node_id);
+    template <class InputIt>
+    void assign_sorted(InputIt first, InputIt last) {
+        CheckWritable();
+        clear();
+        if constexpr (std::random_access_iterator<InputIt>) {
+            assert(std::adjacent_find(first, last, [](const value_type& a, const value_type& b) {
+                return kMulti ? value_compare{}(b, a) : !value_compare{}(a, b);
+            }) == last);
+            BuildSorted(static_cast<size_type>(last - first), [&](size_type i) -> decltype(auto) {
+                return first[i];
+            });
         }
         else {
-            assert(node->GetRight() == node_id);
-            node->SetRight(new_node_id);
+            std::vector<value_type> values(first, last);
+            BuildSorted(static_cast<size_type>(values.size()), [&](size_type i) -> value_type&& {
+                return std::move(values[i]);
+            });
         }
     }
+
     /*
-    * 
+    * hint룬hintЯ·ᱻãֻ˱ҪĲ
     */
-    NodeAddress RotateRight(Node* sub_root_parent, NodeAddress sub_root_id, Node* sub_root) {
-        NodeAddress new_sub_root_id = sub_root->GetLeft();
-        if (new_sub_root_id == kInvalidAddress) {
-            return sub_root_id;
-        }
-        Node* new_sub_root = allocator_.reference(new_sub_root_id);
-
-        if (sub_root_parent != nullptr) {
-            ReplaceChild(sub_root_parent, sub_root_id, new_sub_root_id);
-        }
-
-        sub_root->SetLeft(new_sub_root->GetRight());
-        new_sub_root->SetRight(sub_root_id);
+    iterator insert(const_iterator hint, const value_type& value) {
+        DropExpired();
+        IteratorStack stack = HintPath(hint);
+        return EmplaceNear(stack, Traits::GetKey(value), value).first;
+    }
 
-        allocator_.dereference(new_sub_root);
-        return new_sub_root_id;
+    iterator insert(const_iterator hint, value_type&& value) {
+        DropExpired();
+        IteratorStack stack = HintPath(hint);
+        return EmplaceNear(stack, Traits::GetKey(value), std::move(value)).first;
     }
+
     /*
-    * 
+    * ()Уһβ·ڵkeyֻ
+    * ׷ӵֵ֮ʱֱӹҽӣ̯O(1)½
     */
-    NodeAddress RotateLeft(Node* sub_root_parent, NodeAddress sub_root_id, Node* sub_root) {
-        NodeAddress new_sub_root_id = sub_root->GetRight();
-        if (new_sub_root_id == kInvalidAddress) {
-            return sub_root_id;
+    template <class InputIt>
+    void insert_sorted(InputIt first, InputIt last) {
+        DropExpired();
+        IteratorStack stack;
+        NodeAddress max_id = kInvalidAddress;
+        if (root_ != kInvalidAddress) {
+            std::tie(max_id, stack) = Last();
+            stack.push_back(max_id);
         }
-        Node* new_sub_root = allocator_.reference(new_sub_root_id);
-
-        if (sub_root_parent != nullptr) {
-            ReplaceChild(sub_root_parent, sub_root_id, new_sub_root_id);
+        for (; first != last; ++first) {
+            if constexpr (std::is_same_v<std::remove_cvref_t<std::iter_reference_t<InputIt>>, value_type>) {
+                InsertSortedStep(stack, max_id, *first);
+            }
+            else {
+                InsertSortedStep(stack, max_id, value_type(*first));
+            }
         }
+    }
+
+    /*
+    * ظkeyʱɾȵԪأ·ɾӸ
+    */
+    size_type erase(const key_type& key) {
+        if constexpr (kMulti) {
+            size_type old_size = size_;
+            auto [first, last] = equal_range(key);
+            erase(first, last);
+            return old_size - size_;
+        }
+        else {
+            IteratorStack stack;
+            auto [node_id, ordering] = Find(stack, key);
+            if (node_id == kInvalidAddress || ordering != 0) {
+                return 0;
+            }
+            EraseNode(stack, node_id);
+            return 1;
+        }
+    }
+
+    /*
+    * ֱʹõб·ɾٴӸ(·޸Ĺʱ)
+    */
+    iterator erase(const_iterator pos) {
+        assert(pos.node_address_ != kInvalidAddress);
+        IteratorStack stack = PathOf(pos);
+        NodeAddress next_id = EraseNext(stack, pos.node_address_);
+        return iterator{ this, next_id, std::move(stack) };
+    }
+
+    iterator erase(iterator pos) {
+        return erase(static_cast<const_iterator&>(pos));
+    }
+
+    /*
+    * first·ɾÿɾһԪֻ·ʣǰ׺̵·
+    * ɾȫԪʱ˻Ϊclear
+    */
+    iterator erase(const_iterator first, const_iterator last) {
+        CheckWritable();
+        if (first == cbegin() && last == cend()) {
+            clear();
+            return end();
+        }
+        IteratorStack stack = PathOf(first);
+        NodeAddress node_id = first.node_address_;
+        while (node_id != last.node_address_) {
+            node_id = EraseNext(stack, node_id);
+        }
+        return iterator{ this, node_id, std::move(stack) };
+    }
+
+    /*
+    * key֣СkeyԪأright(ԭݱ)
+    * ֱڸƴӣO(log n)ڴʱСһƶһڴأO(log n + min(k, n - k))
+    * ͬһarenaʱֱӽڵ㣬ƶԪأ֪ĴС
+    * kOrderStatisticʱΪO(log n)ֱСһO(log n + min(k, n - k))
+    */
+    void split(const Key& key, RbTree& right) {
+        SplitTree(key, right);
+    }
+
+    template <class K, class Kc = key_compare, class = typename Kc::is_transparent>
+    void split(const K& x, RbTree& right) {
+        SplitTree(x, right);
+    }
+
+    /*
+    * rightȫԪƴӵ֮ҪԪؾСrightеԪ(multi)
+    * ṹƴO(log n)СһԪƶһڴ
+    * ͬһarenaʱƶԪ
+    */
+    void join(RbTree&& right) {
+        if (right.root_ == kInvalidAddress) {
+            return;
+        }
+        if (root_ == kInvalidAddress && !kMapped) {
+            *this = std::move(right);
+            return;
+        }
+        if (root_ != kInvalidAddress) {
+            CheckJoinOrder(Traits::GetKey(GetValue(std::get<0>(Last()))), Traits::GetKey(right.GetValue(std::get<0>(right.First()))));
+        }
+        JoinTree(std::move(right));
+    }
+
+    /*
+    * pivotΪмԪƴӣҪ < pivot < right
+    */
+    void join(value_type pivot, RbTree&& right) {
+        const Key& pivot_key = Traits::GetKey(pivot);
+        if (root_ != kInvalidAddress) {
+            CheckJoinOrder(Traits::GetKey(GetValue(std::get<0>(Last()))), pivot_key);
+        }
+        if (right.root_ != kInvalidAddress) {
+            CheckJoinOrder(pivot_key, Traits::GetKey(right.GetValue(std::get<0>(right.First()))));
+        }
+        JoinTree(std::move(right), std::move(pivot));
+    }
+
+    /*
+    * 㣬滻ݣother䣬keyͬʱԪ
+    * ԽСһΪΣڵһĶӦһΪ໥أɲ㲢ִ
+    * һһ㶨λ½ǴӸʼλĹΪO(m log(n/m + 1))(mnΪСϴһĴС)
+    * ν׶ֻռһԹΪ覨(С)
+    * ΪO(m log(n/m + 1) + m)Ľɴn + mԪأ(n + m)
+    * Զother(m log n < n)ʱؽֱڱвɾotherԪأO(m log n)
+    */
+    void set_union(const RbTree& other) requires (!kMulti) {
+        SetOperation(other, SetOperationPlan{ true, true, true });
+    }
+
+    void set_intersection(const RbTree& other) requires (!kMulti) {
+        SetOperation(other, SetOperationPlan{ false, false, true });
+    }
+
+    void set_difference(const RbTree& other) requires (!kMulti) {
+        SetOperation(other, SetOperationPlan{ true, false, false });
+    }
+
+    /*
+    * iterator
+    */
+    /*
+    * Сڵѻ棬O(1)·ڵһƶʱ
+    */
+    iterator begin() noexcept {
+        return iterator{ this, leftmost_ };
+    }
+
+    const_iterator begin() const noexcept {
+        return const_iterator{ this, leftmost_ };
+    }
+
+    iterator end() noexcept {
+        return iterator{ this, kInvalidAddress, IteratorStack{} };
+    }
+
+    const_iterator end() const noexcept {
+        return const_iterator{ this, kInvalidAddress, IteratorStack{} };
+    }
+
+    [[nodiscard]] reverse_iterator rbegin() noexcept {
+        return reverse_iterator(end());
+    }
+
+    [[nodiscard]] const_reverse_iterator rbegin() const noexcept {
+        return const_reverse_iterator(end());
+    }
+
+    [[nodiscard]] reverse_iterator rend() noexcept {
+        return reverse_iterator(begin());
+    }
+
+    [[nodiscard]] const_reverse_iterator rend() const noexcept {
+        return const_reverse_iterator(begin());
+    }
+
+    [[nodiscard]] const_iterator cbegin() const noexcept {
+        return begin();
+    }
+
+    [[nodiscard]] const_iterator cend() const noexcept {
+        return end();
+    }
+
+    [[nodiscard]] const_reverse_iterator crbegin() const noexcept {
+        return rbegin();
+    }
+
+    [[nodiscard]] const_reverse_iterator crend() const noexcept {
+        return rend();
+    }
+
+    /*
+    * ɾС/ԪأΪ
+    * ɾҪ·ֵڵ㲻Я·/Ӹ½O(log n)
+    * ֻ鿴ֵʱӦʹbegin()/rbegin()O(1)
+    */
+    value_type pop_min() {
+        assert(root_ != kInvalidAddress);
+        IteratorStack stack;
+        NodeAddress node_id = LeftMost(stack, root_);
+        value_type value = std::move(GetValue(node_id));
+        EraseNode(stack, node_id);
+        return value;
+    }
+
+    value_type pop_max() {
+        assert(root_ != kInvalidAddress);
+        IteratorStack stack;
+        NodeAddress node_id = RightMost(stack, root_);
+        value_type value = std::move(GetValue(node_id));
+        EraseNode(stack, node_id);
+        return value;
+    }
+
+    /*
+    * 򹹽ֻľ̬ұ½cache missO(n)
+    * еԪأ޸ĺҪfreeze
+    */
+    frozen_index freeze() const {
+        return frozen_index{ *this };
+    }
+
+    /*
+    * cursorָ·ĵO(log n)
+    */
+    iterator resume(cursor pos) noexcept {
+        IteratorStack stack;
+        if (pos.node_address_ != kInvalidAddress) {
+            PathTo(stack, pos.node_address_);
+        }
+        return iterator{ this, pos.node_address_, std::move(stack) };
+    }
+
+    const_iterator resume(cursor pos) const noexcept {
+        IteratorStack stack;
+        if (pos.node_address_ != kInvalidAddress) {
+            PathTo(stack, pos.node_address_);
+        }
+        return const_iterator{ this, pos.node_address_, std::move(stack) };
+    }
+
+protected:
+    NodeAddress Find(const Key& key) const {
+        IteratorStack stack;
+        auto [node_addr, ordering] = Find(stack, key);
+        return ordering == 0 ? node_addr : kInvalidAddress;
+    }
+
+    /*
+    * ֤
+    */
+    bool VerifyTree() {
+        Node* node = allocator_.reference(root_);
+        if (!node) return true;
+        bool correct = false;
+        do {
+            if (node->GetColor() != kBlack) break;
+            typename AllocatorType::difference_type high = 1;
+            while (node->GetLeft() != kInvalidAddress) {
+                NodeAddress node_id = node->GetLeft();
+                allocator_.dereference(node);
+                node = allocator_.reference(node_id);
+                /* ɫڵ㲻ʾ߶ */
+                if (node->GetColor() == kBlack) {
+                    high++;
+                }
+            }
+            correct = CheckPath(kInvalidAddress, root_, 0, high);
+            correct = correct && leftmost_ == std::get<0>(First()) && rightmost_ == std::get<0>(Last());
+            if constexpr (kOrderStatistic) {
+                correct = correct && CheckCount(root_) == size_;
+            }
+            if constexpr (kAggregate) {
+                if constexpr (std::equality_comparable<typename Monoid::Aggregate>) {
+                    correct = correct && CheckAggregate(root_);
+                }
+            }
+        } while (false);
+        allocator_.dereference(node);
+        return correct;
+    }
+
+
+    std::tuple<NodeAddress, IteratorStack> First() const noexcept {
+        IteratorStack stack;
+        NodeAddress node_id = root_;
+        if (node_id != kInvalidAddress) {
+            node_id = LeftMost(stack, node_id);
+        }
+        return std::tuple{ node_id, std::move(stack) };
+    }
+
+    std::tuple<NodeAddress, IteratorStack> Last() const noexcept {
+        IteratorStack stack;
+        NodeAddress node_id = root_;
+        if (node_id != kInvalidAddress) {
+            node_id = RightMost(stack, node_id);
+        }
+        return std::tuple{ node_id, std::move(stack) };
+    }
+
+    /*
+    * sub_root_idΪСĽڵ㣬;Ľڵᱻѹջ
+    */
+    NodeAddress LeftMost(IteratorStack& stack, NodeAddress sub_root_id) const noexcept {
+        NodeAddress cur_id = sub_root_id;
+        Node* cur = allocator_.reference(cur_id);
+        while (cur->GetLeft() != kInvalidAddress) {
+            stack.push_back(cur_id);
+            cur_id = cur->GetLeft();
+            allocator_.dereference(cur);
+            cur = allocator_.reference(cur_id);
+        }
+        allocator_.dereference(cur);
+        return cur_id;
+    }
+
+    /*
+    * sub_root_idΪĽڵ㣬;Ľڵᱻѹջ
+    */
+    NodeAddress RightMost(IteratorStack& stack, NodeAddress sub_root_id) const noexcept {
+        NodeAddress cur_id = sub_root_id;
+        Node* cur = allocator_.reference(cur_id);
+        while (cur->GetRight() != kInvalidAddress) {
+            stack.push_back(cur_id);
+            cur_id = cur->GetRight();
+            allocator_.dereference(cur);
+            cur = allocator_.reference(cur_id);
+        }
+        allocator_.dereference(cur);
+        return cur_id;
+    }
+
+    /*
+    * 
+    * ջΪnode_id·ͬΪ̽ڵ·
+    * ÿ౻СݸһΣʱÿ̯O(1)
+    */
+    NodeAddress Next(IteratorStack& stack, NodeAddress node_id) const noexcept {
+        Node* node = allocator_.reference(node_id);
+        NodeAddress right_id = node->GetRight();
+        allocator_.dereference(node);
+        if (right_id != kInvalidAddress) {
+            /* СĽڵ */
+            stack.push_back(node_id);
+            return LeftMost(stack, right_id);
+        }
+        /* ϻݣһصȼΪ */
+        while (!stack.empty()) {
+            NodeAddress parent_id = stack.front(); stack.pop_back();
+            Node* parent = allocator_.reference(parent_id);
+            bool is_left = parent->GetLeft() == node_id;
+            allocator_.dereference(parent);
+            if (is_left) {
+                return parent_id;
+            }
+            node_id = parent_id;
+        }
+        return kInvalidAddress;
+    }
+
+    /*
+    * ǰNextԳ
+    */
+    NodeAddress Prev(IteratorStack& stack, NodeAddress node_id) const noexcept {
+        Node* node = allocator_.reference(node_id);
+        NodeAddress left_id = node->GetLeft();
+        allocator_.dereference(node);
+        if (left_id != kInvalidAddress) {
+            stack.push_back(node_id);
+            return RightMost(stack, left_id);
+        }
+        while (!stack.empty()) {
+            NodeAddress parent_id = stack.front(); stack.pop_back();
+            Node* parent = allocator_.reference(parent_id);
+            bool is_right = parent->GetRight() == node_id;
+            allocator_.dereference(parent);
+            if (is_right) {
+                return parent_id;
+            }
+            node_id = parent_id;
+        }
+        return kInvalidAddress;
+    }
+
+    /*
+    * һСkeyĽڵ㣬ջΪ·ʱkInvalidAddressջΪ
+    * ½ʱ¼һתλãջضϵò㼴ɣ
+    */
+    template <class K>
+    NodeAddress LowerBound(IteratorStack& stack, const K& key) const {
+        stack.clear();
+        NodeAddress cur_id = root_;
+        NodeAddress bound_id = kInvalidAddress;
+        size_t bound_depth = 0;
+        while (cur_id != kInvalidAddress) {
+            Node* cur = allocator_.reference(cur_id);
+            std::strong_ordering ordering = CompareKey(key, cur->GetKey());
+            NodeAddress next_id;
+            if (ordering == 0 && !kMulti) {
+                /* keyΨһȵĽڵ㼴Ϊ½ */
+                allocator_.dereference(cur);
+                return cur_id;
+            }
+            if (ordering <= 0) {
+                bound_id = cur_id;
+                bound_depth = stack.size();
+                next_id = cur->GetLeft();
+            }
+            else {
+                next_id = cur->GetRight();
+            }
+            allocator_.dereference(cur);
+            stack.push_back(cur_id);
+            cur_id = next_id;
+        }
+        stack.resize(bound_depth);
+        return bound_id;
+    }
+
+    /*
+    * һkeyĽڵ㣬LowerBoundֻͬʱ
+    */
+    template <class K>
+    NodeAddress UpperBound(IteratorStack& stack, const K& key) const {
+        stack.clear();
+        NodeAddress cur_id = root_;
+        NodeAddress bound_id = kInvalidAddress;
+        size_t bound_depth = 0;
+        while (cur_id != kInvalidAddress) {
+            Node* cur = allocator_.reference(cur_id);
+            NodeAddress next_id;
+            if (CompareKey(key, cur->GetKey()) < 0) {
+                bound_id = cur_id;
+                bound_depth = stack.size();
+                next_id = cur->GetLeft();
+            }
+            else {
+                next_id = cur->GetRight();
+            }
+            allocator_.dereference(cur);
+            stack.push_back(cur_id);
+            cur_id = next_id;
+        }
+        stack.resize(bound_depth);
+        return bound_id;
+    }
+
+    /*
+    * ½õequal_rangeϽ磬keyΨһʱǰһһUpperBound½
+    */
+    template <class It, class K>
+    It EqualRangeEnd(It first, const K& key) const {
+        if (first.node_address_ == kInvalidAddress || CompareKey(key, Traits::GetKey(*first)) != 0) {
+            return first;
+        }
+        if constexpr (kMulti) {
+            IteratorStack stack;
+            NodeAddress node_id = UpperBound(stack, key);
+            return It{ first.rb_tree_, node_id, std::move(stack) };
+        }
+        else {
+            ++first;
+            return first;
+        }
+    }
+
+    /*
+    * ջʣnode_idһЧǰ׺(InsertFixup֮)
+    * ǰ׺ĩ˰key²ң뵽node_id·
+    */
+    void RestorePath(IteratorStack& stack, NodeAddress node_id) const noexcept {
+        NodeAddress cur_id = root_;
+        if (!stack.empty()) {
+            cur_id = stack.front(); stack.pop_back();
+        }
+        Node* node = allocator_.reference(node_id);
+        while (cur_id != node_id) {
+            stack.push_back(cur_id);
+            Node* cur = allocator_.reference(cur_id);
+            if (CompareKey(node->GetKey(), cur->GetKey()) < 0) {
+                cur_id = cur->GetLeft();
+            }
+            else {
+                cur_id = cur->GetRight();
+            }
+            allocator_.dereference(cur);
+        }
+        allocator_.dereference(node);
+    }
+
+    /*
+    * б·䴴֮޸Ĺʱ
+    */
+    IteratorStack PathOf(const const_iterator& pos) const noexcept {
+        if (pos.epoch_ == epoch_ || pos.node_address_ == kInvalidAddress) {
+            return pos.stack_;
+        }
+        IteratorStack stack;
+        PathTo(stack, pos.node_address_);
+        return stack;
+    }
+
+    /*
+    * ɽڵַ·
+    * ظkeyʱȶλ㣬ҵnode_id
+    */
+    void PathTo(IteratorStack& stack, NodeAddress node_id) const noexcept {
+        stack.clear();
+        if (node_id == leftmost_) {
+            LeftMost(stack, root_);
+        }
+        else if (node_id == rightmost_) {
+            RightMost(stack, root_);
+        }
+        else if constexpr (kMulti) {
+            NodeAddress cur_id = LowerBound(stack, Traits::GetKey(GetValue(node_id)));
+            while (cur_id != node_id) {
+                cur_id = Next(stack, cur_id);
+            }
+        }
+        else {
+            RestorePath(stack, node_id);
+        }
+    }
+
+    /*
+    * 齻ƽ(group prefetching)
+    * ÿһиֻ½һ㣬ԤȡԼһڵ㣬ֵʱڵڻ
+    * βÿ㶼Ҫȴһcache missmissԲ
+    */
+    template <class ForwardIt, class Emit>
+    void FindBatch(ForwardIt first, ForwardIt last, Emit&& emit) const {
+        constexpr size_t kGroupSize = 16;
+        ForwardIt keys[kGroupSize];
+        NodeAddress cur_ids[kGroupSize];
+        NodeAddress found_ids[kGroupSize];
+        while (first != last) {
+            size_t count = 0;
+            for (; count < kGroupSize && first != last; ++count, ++first) {
+                keys[count] = first;
+                cur_ids[count] = root_;
+                found_ids[count] = kInvalidAddress;
+            }
+            bool active = root_ != kInvalidAddress;
+            while (active) {
+                active = false;
+                for (size_t i = 0; i < count; i++) {
+                    NodeAddress cur_id = cur_ids[i];
+                    if (cur_id == kInvalidAddress) {
+                        continue;
+                    }
+                    Node* cur = allocator_.reference(cur_id);
+                    std::strong_ordering ordering = CompareKey(*keys[i], cur->GetKey());
+                    NodeAddress next_id = ordering < 0 ? cur->GetLeft() : cur->GetRight();
+                    allocator_.dereference(cur);
+                    if (ordering == 0) {
+                        found_ids[i] = cur_id;
+                        next_id = kInvalidAddress;
+                    }
+                    cur_ids[i] = next_id;
+                    if (next_id != kInvalidAddress) {
+                        Node* next = allocator_.reference(next_id);
+                        detail::Prefetch(next);
+                        allocator_.dereference(next);
+                        active = true;
+                    }
+                }
+            }
+            for (size_t i = 0; i < count; i++) {
+                emit(found_ids[i]);
+            }
+        }
+    }
+
+    /*
+    * ջΪӸĳڵ·(ýڵ)
+    * ˵keyڵ㣬֮FindFromջ½
+    * ڵֻתתȾҵȼֹͣ
+    * ˲һλõkeyľأʱ̯O(1)
+    */
+    template <class K>
+    void NarrowPath(IteratorStack& stack, const K& key) const {
+        if (stack.empty()) {
+            return;
+        }
+        size_t candidate = stack.size() - 1;
+        bool has_lower = false, has_upper = false;
+        /* keyջڵһʱòȱ߽Ȼ */
+        Node* top = allocator_.reference(stack[candidate]);
+        std::strong_ordering top_ordering = CompareKey(key, top->GetKey());
+        allocator_.dereference(top);
+        if (top_ordering > 0) {
+            has_lower = true;
+        }
+        else if (top_ordering < 0) {
+            has_upper = true;
+        }
+        for (size_t i = candidate; i > 0 && !(has_lower && has_upper); i--) {
+            NodeAddress child_id = stack[i];
+            Node* parent = allocator_.reference(stack[i - 1]);
+            bool is_left = parent->GetLeft() == child_id;
+            if (is_left ? !has_upper : !has_lower) {
+                std::strong_ordering ordering = CompareKey(key, parent->GetKey());
+                if (is_left ? ordering < 0 : ordering > 0) {
+                    (is_left ? has_upper : has_lower) = true;
+                }
+                else {
+                    /* Խ˸ȵı߽磬Ƶȣռ߽ */
+                    candidate = i - 1;
+                    has_lower = has_upper = false;
+                }
+            }
+            allocator_.dereference(parent);
+        }
+        stack.resize(candidate + 1);
+    }
+
+    /*
+    * hintʼ룬ջΪӸhint·(hint)
+    */
+    template <class K, class... Args>
+    std::pair<iterator, bool> EmplaceNear(IteratorStack& stack, const K& key, Args&&... args) {
+        NarrowPath(stack, key);
+        auto [node_id, ordering] = FindInsertFrom(stack, key);
+        if (node_id != kInvalidAddress && ordering == 0) {
+            return std::pair{ iterator{ this, node_id, std::move(stack) }, false };
+        }
+        node_id = EmplaceAt(stack, node_id, ordering, std::forward<Args>(args)...);
+        return std::pair{ iterator{ this, node_id, std::move(stack) }, true };
+    }
+
+    /*
+    * Ȱkeyңkeyʱŷڵ㲢argsԭλԪ
+    */
+    template <class K, class... Args>
+    std::pair<iterator, bool> EmplaceKey(const K& key, Args&&... args) {
+        DropExpired();
+        IteratorStack stack;
+        auto [node_id, ordering] = FindInsertFrom(stack, key);
+        if (node_id != kInvalidAddress && ordering == 0) {
+            return std::pair{ iterator{ this, node_id, std::move(stack) }, false };
+        }
+        node_id = EmplaceAt(stack, node_id, ordering, std::forward<Args>(args)...);
+        return std::pair{ iterator{ this, node_id, std::move(stack) }, true };
+    }
+
+    /*
+    * ½ڵҽΪparent_idĺ(ordering)ƽ
+    * stackparent_idorderingͬһFindʱstackΪ½ڵ·
+    */
+    template <class... Args>
+    NodeAddress EmplaceAt(IteratorStack& stack, NodeAddress parent_id, std::strong_ordering ordering, Args&&... args) {
+        NodeAddress node_id = CreateNode(std::forward<Args>(args)...);
+        LinkAt(stack, parent_id, ordering, node_id);
+        return node_id;
+    }
+
+    /*
+    * ޷ǰȡkeyʱȹڵٲңkeyѴ½ڵ
+    */
+    template <class... Args>
+    std::pair<iterator, bool> EmplaceNode(Args&&... args) {
+        DropExpired();
+        NodeAddress node_id = CreateNode(std::forward<Args>(args)...);
+        Node* node = allocator_.reference(node_id);
+        IteratorStack stack;
+        auto [parent_id, ordering] = FindInsertFrom(stack, node->GetKey());
+        if (parent_id != kInvalidAddress && ordering == 0) {
+            std::destroy_at<Node>(node);
+            allocator_.dereference(node);
+            allocator_.deallocate(node_id);
+            return std::pair{ iterator{ this, parent_id, std::move(stack) }, false };
+        }
+        allocator_.dereference(node);
+        LinkAt(stack, parent_id, ordering, node_id);
+        return std::pair{ iterator{ this, node_id, std::move(stack) }, true };
+    }
+
+    /*
+    * δĽڵ㣬ڴصĵַܱNodeAddressԭϼ
+    * ޵ĵַڴʵĽڵ(Чַ)ȹ黹ýڵöʧ
+    */
+    NodeAddress AllocateNode() {
+        auto node_id = allocator_.allocate();
+        if (node_id > kMaxAddress) {
+            if constexpr (requires { AllocatorType::kInvalidAddress; }) {
+                if (node_id != AllocatorType::kInvalidAddress) {
+                    allocator_.deallocate(node_id);
+                }
+            }
+            else {
+                allocator_.deallocate(node_id);
+            }
+            throw std::bad_alloc();     // "The maximum node limit of the tree has been reached."
+        }
+        return static_cast<NodeAddress>(node_id);
+    }
+
+    /*
+    * ڵ㲢argsԭλԪ
+    * ļӳڴallocateʱӳ䣬argsñеԪ(insert(*begin()))֮ʧЧ
+    * ջϹԪٷ䣬ԪҪƽƣĸƿС
+    */
+    template <class... Args>
+    NodeAddress CreateNode(Args&&... args) {
+        if constexpr (kMapped) {
+            Element element(std::forward<Args>(args)...);
+            NodeAddress node_id = AllocateNode();
+            Node* node = allocator_.reference(node_id);
+            std::construct_at<Node>(node, std::move(element));
+            allocator_.dereference(node);
+            return node_id;
+        }
+        NodeAddress node_id = AllocateNode();
+        Node* node = allocator_.reference(node_id);
+        try {
+            std::construct_at<Node>(node, std::forward<Args>(args)...);
+        }
+        catch (...) {
+            allocator_.dereference(node);
+            allocator_.deallocate(node_id);
+            throw;
+        }
+        allocator_.dereference(node);
+        return node_id;
+    }
+
+    /*
+    * ѹĽڵҽΪparent_idĺӲƽ⣬ʱstackΪ½ڵ·
+    */
+    void LinkAt(IteratorStack& stack, NodeAddress parent_id, std::strong_ordering ordering, NodeAddress node_id) {
+        if (parent_id == kInvalidAddress) {
+            root_ = node_id;
+            leftmost_ = node_id;
+            rightmost_ = node_id;
+        }
+        else {
+            Node* parent = allocator_.reference(parent_id);
+            if (ordering < 0) {
+                parent->SetLeft(node_id);
+            }
+            else {
+                parent->SetRight(node_id);
+            }
+            allocator_.dereference(parent);
+            stack.push_back(parent_id);
+            /* ֵڵ༴Ϊµֵ */
+            if (parent_id == leftmost_ && ordering < 0) {
+                leftmost_ = node_id;
+            }
+            else if (parent_id == rightmost_ && ordering >= 0) {
+                rightmost_ = node_id;
+            }
+        }
+        ++size_;
+        ++epoch_;
+        UpdatePath(stack, 1);
+        InsertFixup(stack, node_id);
+        RestorePath(stack, node_id);
+    }
+
+    /*
+    * insert_sortedĵstackΪһλõ·max_idΪǰڵ
+    */
+    template <class V>
+    void InsertSortedStep(IteratorStack& stack, NodeAddress& max_id, V&& value) {
+        const Key& key = Traits::GetKey(value);
+        bool is_append = false;
+        if (max_id != kInvalidAddress && stack.front() == max_id) {
+            /* һڵֵkeyֱΪҺ */
+            Node* max_node = allocator_.reference(max_id);
+            std::strong_ordering ordering = CompareKey(key, max_node->GetKey());
+            is_append = ordering > 0 || (kMulti && ordering == 0);
+            allocator_.dereference(max_node);
+        }
+        if (!is_append) {
+            NarrowPath(stack, key);
+        }
+        auto [node_id, ordering] = FindInsertFrom(stack, key);
+        if (node_id == kInvalidAddress || ordering != 0) {
+            is_append = root_ == kInvalidAddress || (node_id == max_id && ordering > 0);
+            node_id = EmplaceAt(stack, node_id, ordering, std::forward<V>(value));
+            if (is_append) {
+                max_id = node_id;
+            }
+        }
+        stack.push_back(node_id);
+    }
+
+    /*
+    * ȡhint·(hint)end()ȡڵ·
+    */
+    IteratorStack HintPath(const const_iterator& hint) const {
+        IteratorStack stack;
+        NodeAddress node_id = hint.node_address_;
+        if (node_id == kInvalidAddress) {
+            if (root_ == kInvalidAddress) {
+                return stack;
+            }
+            std::tie(node_id, stack) = Last();
+        }
+        else {
+            stack = PathOf(hint);
+        }
+        stack.push_back(node_id);
+        return stack;
+    }
+
+    /*
+    * Traitsṩ·ȽϣÿֻȽһ
+    */
+    template <class K1, class K2>
+    static std::strong_ordering CompareKey(const K1& a, const K2& b) {
+        return Traits::ThreeWayCompare::Compare(a, b);
+    }
+
+    /*
+    * СΪ0
+    */
+    size_type GetCount(NodeAddress node_id) const noexcept {
+        if (node_id == kInvalidAddress) {
+            return 0;
+        }
+        Node* node = allocator_.reference(node_id);
+        size_type count = node->GetCount();
+        allocator_.dereference(node);
+        return count;
+    }
+
+    /*
+    * ۺֵΪλԪ
+    */
+    auto GetAggregate(NodeAddress node_id) const requires kAggregate {
+        if (node_id == kInvalidAddress) {
+            return Monoid::Identity();
+        }
+        Node* node = allocator_.reference(node_id);
+        typename Monoid::Aggregate aggregate = node->GetAggregate();
+        allocator_.dereference(node);
+        return aggregate;
+    }
+
+    /*
+    * ҵһ[lo, hi)еĽڵ(߽·ķֲ)
+    * ߽ռ>=loĲ֣ұ߽ռ<hiĲ֣߽ڲֱȡۺֵ
+    */
+    template <class K1, class K2>
+    auto Reduce(const K1& lo, const K2& hi) const requires kAggregate {
+        NodeAddress split_id = root_;
+        while (split_id != kInvalidAddress) {
+            Node* node = allocator_.reference(split_id);
+            NodeAddress next_id;
+            if (CompareKey(node->GetKey(), lo) < 0) {
+                next_id = node->GetRight();
+            }
+            else if (CompareKey(node->GetKey(), hi) >= 0) {
+                next_id = node->GetLeft();
+            }
+            else {
+                allocator_.dereference(node);
+                break;
+            }
+            allocator_.dereference(node);
+            split_id = next_id;
+        }
+        if (split_id == kInvalidAddress) {
+            return Monoid::Identity();
+        }
+        Node* split = allocator_.reference(split_id);
+        auto result = Monoid::FromValue(Traits::GetValue(split->GetElement()));
+        NodeAddress left_id = split->GetLeft(), right_id = split->GetRight();
+        allocator_.dereference(split);
+
+        auto left = Monoid::Identity();
+        while (left_id != kInvalidAddress) {
+            Node* node = allocator_.reference(left_id);
+            if (CompareKey(node->GetKey(), lo) >= 0) {
+                /* ǰڵڷΧڣλռ֮ǰ */
+                left = Monoid::Combine(Monoid::Combine(Monoid::FromValue(Traits::GetValue(node->GetElement())), GetAggregate(node->GetRight())), left);
+                left_id = node->GetLeft();
+            }
+            else {
+                left_id = node->GetRight();
+            }
+            allocator_.dereference(node);
+        }
+        auto right = Monoid::Identity();
+        while (right_id != kInvalidAddress) {
+            Node* node = allocator_.reference(right_id);
+            if (CompareKey(node->GetKey(), hi) < 0) {
+                right = Monoid::Combine(right, Monoid::Combine(GetAggregate(node->GetLeft()), Monoid::FromValue(Traits::GetValue(node->GetElement()))));
+                right_id = node->GetRight();
+            }
+            else {
+                right_id = node->GetLeft();
+            }
+            allocator_.dereference(node);
+        }
+        return Monoid::Combine(Monoid::Combine(left, result), right);
+    }
+
+    /*
+    * ԭ޸posֵ֮¼ȵľۺֵ
+    */
+    void RefreshAggregate(const const_iterator& pos) {
+        if constexpr (kAggregate) {
+            Node* node = allocator_.reference(pos.node_address_);
+            UpdateAggregate(node);
+            allocator_.dereference(node);
+            UpdatePath(PathOf(pos), 0);
+        }
+    }
+
+    /*
+    * С½ջΪؽڵ·
+    */
+    NodeAddress Nth(IteratorStack& stack, size_type k) const noexcept {
+        if (k >= size_) {
+            return kInvalidAddress;
+        }
+        NodeAddress cur_id = root_;
+        while (true) {
+            Node* cur = allocator_.reference(cur_id);
+            size_type left_count = GetCount(cur->GetLeft());
+            NodeAddress next_id;
+            if (k < left_count) {
+                next_id = cur->GetLeft();
+            }
+            else if (k == left_count) {
+                allocator_.dereference(cur);
+                return cur_id;
+            }
+            else {
+                k -= left_count + 1;
+                next_id = cur->GetRight();
+            }
+            allocator_.dereference(cur);
+            stack.push_back(cur_id);
+            cur_id = next_id;
+        }
+    }
+
+    /*
+    * LowerBoundͬ½ʱۼ뵱ǰڵ
+    */
+    template <class K>
+    size_type Rank(const K& key) const {
+        size_type rank = 0;
+        NodeAddress cur_id = root_;
+        while (cur_id != kInvalidAddress) {
+            Node* cur = allocator_.reference(cur_id);
+            NodeAddress next_id;
+            if (CompareKey(key, cur->GetKey()) <= 0) {
+                next_id = cur->GetLeft();
+            }
+            else {
+                rank += GetCount(cur->GetLeft()) + 1;
+                next_id = cur->GetRight();
+            }
+            allocator_.dereference(cur);
+            cur_id = next_id;
+        }
+        return rank;
+    }
+
+    value_type& GetValue(NodeAddress node_id) const noexcept {
+        Node* node = allocator_.reference(node_id);
+        value_type& value = Traits::GetValue(node->GetElement());
+        allocator_.dereference(node);
+        return value;
+    }
+
+    const Key& GetKey(NodeAddress node_id) const noexcept {
+        return Traits::GetKey(GetValue(node_id));
+    }
+
+    /*
+    * ظԵϹO(n)
+    * е㻮ֵ֣ĴС֮1˿ֻڵ
+    * һ㲻ʱȾ죬ڵΪɫ
+    * ڵ㰴䣬ʹʱؾĽڵڴ
+    * get(i)صiԪأԭλ
+    */
+    template <class Getter>
+    void BuildSorted(size_type count, Getter&& get) {
+        assert(root_ == kInvalidAddress);
+        if (count == 0) {
+            return;
+        }
+        if (count > kMaxAddress) {
+            throw std::bad_alloc();
+        }
+        struct Range {
+            size_type begin;
+            size_type end;
+            NodeAddress parent_id;
+            bool is_left;
+        };
+        const uint32_t height = std::bit_width(count);
+        const bool is_perfect = std::has_single_bit(count + 1);
+        std::vector<Range> level, next_level;
+        /* ۺֵԵϼ㣬¼ڵ㣬ɺ */
+        std::vector<NodeAddress> order;
+        if constexpr (kAggregate) {
+            order.reserve(count);
+        }
+        level.push_back(Range{ 0, count, kInvalidAddress, false });
+        for (uint32_t depth = 0; !level.empty(); ++depth) {
+            Color color = (depth + 1 == height && !is_perfect) ? kRed : kBlack;
+            next_level.clear();
+            for (auto& range : level) {
+                size_type mid = range.begin + (range.end - range.begin) / 2;
+                NodeAddress node_id = AllocateNode();
+                Node* node = allocator_.reference(node_id);
+                std::construct_at<Node>(node, get(mid));
+                node->SetColor(color);
+                if constexpr (kOrderStatistic) {
+                    node->SetCount(static_cast<NodeAddress>(range.end - range.begin));
+                }
+                allocator_.dereference(node);
+                if constexpr (kAggregate) {
+                    order.push_back(node_id);
+                }
+                ++size_;
+                ++epoch_;
+
+                if (range.parent_id == kInvalidAddress) {
+                    root_ = node_id;
+                }
+                else {
+                    Node* parent = allocator_.reference(range.parent_id);
+                    if (range.is_left) {
+                        parent->SetLeft(node_id);
+                    }
+                    else {
+                        parent->SetRight(node_id);
+                    }
+                    allocator_.dereference(parent);
+                }
+                if (range.begin < mid) {
+                    next_level.push_back(Range{ range.begin, mid, node_id, true });
+                }
+                if (mid + 1 < range.end) {
+                    next_level.push_back(Range{ mid + 1, range.end, node_id, false });
+                }
+            }
+            level.swap(next_level);
+        }
+        if constexpr (kAggregate) {
+            for (size_t i = order.size(); i-- > 0;) {
+                Node* node = allocator_.reference(order[i]);
+                UpdateAggregate(node);
+                allocator_.dereference(node);
+            }
+        }
+        ResetBounds();
+    }
+
+    /*
+    * ıĽṹ(֡ƴ)ֵ֮ڵ
+    */
+    void ResetBounds() noexcept {
+        leftmost_ = kInvalidAddress;
+        rightmost_ = kInvalidAddress;
+        if (root_ != kInvalidAddress) {
+            IteratorStack stack;
+            leftmost_ = LeftMost(stack, root_);
+            stack.clear();
+            rightmost_ = RightMost(stack, root_);
+        }
+    }
+
+private:
+    /*
+    * ڴенڵ㣬ļӳڴرӳֻ
+    * arenaͷţڵDestroyElements黹
+    */
+    void ResetPool() noexcept {
+        if constexpr (kMapped || kShared) {
+            allocator_.reset();
+        }
+        else {
+            allocator_ = AllocatorType{};
+        }
+    }
+
+    /*
+    * ½ʹõڴأarenaʱͬһarena
+    */
+    AllocatorType NewPool() const noexcept {
+        if constexpr (kShared) {
+            return AllocatorType{ allocator_.arena() };
+        }
+        else {
+            return AllocatorType{};
+        }
+    }
+
+    /*
+    * ĽڵǷͬһarenaУʱֱ໥
+    */
+    bool IsSameArena(const RbTree& right) const noexcept {
+        if constexpr (kShared) {
+            return allocator_.shared() && allocator_.arena() == right.allocator_.arena();
+        }
+        else {
+            return false;
+        }
+    }
+
+    /*
+    * ļӳʱСдļͷ
+    */
+    void SyncPool() noexcept {
+        if constexpr (kMapped) {
+            allocator_.Sync(root_, size_);
+        }
+    }
+
+    /*
+    * ֻӳĽڵ㲻д޸ĽṹԪ֮ǰ飬дֻڴ
+    * 飬ڵʱڴ׳
+    */
+    void CheckWritable() const {
+        if constexpr (kMapped) {
+            if (!allocator_.writable()) {
+                throw std::logic_error("rbt tree is mapped read-only");
+            }
+        }
+    }
+
+    /*
+    * arenaúԭеĽڵѲڣǰʧЧĸΪ
+    * ½ڵҽյĸϣarenaĽڵһ
+    */
+    void DropExpired() noexcept {
+        if constexpr (kShared) {
+            if (allocator_.expired()) {
+                root_ = kInvalidAddress;
+                leftmost_ = kInvalidAddress;
+                rightmost_ = kInvalidAddress;
+                size_ = 0;
+                allocator_.reset();
+                ++epoch_;
+                compact_.reset();
+            }
+        }
+    }
+
+    /*
+    * Ԫأڵ㱾ڴͷţ黹
+    * arenaеĽڵ黹arenaѱʱڵѲڣֱ
+    */
+    void DestroyElements() noexcept {
+        if constexpr (kShared) {
+            if (allocator_.shared()) {
+                if (!allocator_.expired()) {
+                    FreeSubtree(root_);
+                }
+                return;
+            }
+        }
+        if constexpr (!std::is_trivially_destructible_v<Node>) {
+            if (root_ == kInvalidAddress) {
+                return;
+            }
+            /* ÿһҺӣջȲ */
+            IteratorStack stack;
+            stack.push_back(root_);
+            while (!stack.empty()) {
+                NodeAddress node_id = stack.front(); stack.pop_back();
+                Node* node = allocator_.reference(node_id);
+                if (node->GetRight() != kInvalidAddress) stack.push_back(node->GetRight());
+                if (node->GetLeft() != kInvalidAddress) stack.push_back(node->GetLeft());
+                std::destroy_at<Node>(node);
+                allocator_.dereference(node);
+            }
+        }
+    }
+
+    /*
+    * 滻ºӽڵ
+    */
+    void ReplaceChild(Node* node, NodeAddress node_id, NodeAddress new_node_id) {
+        if (node->GetLeft() == node_id) {
+            node->SetLeft(new_node_id);
+        }
+        else {
+            assert(node->GetRight() == node_id);
+            node->SetRight(new_node_id);
+        }
+    }
+    /*
+    * תǰܴС䣬Ӹֱӽ棬Ӹɺ¼
+    * ۺֵ߶ɺ¼㣬CombineĽɣҲؽһ
+    */
+    void RotateAugment(Node* old_sub_root, Node* new_sub_root) const {
+        if constexpr (kOrderStatistic) {
+            new_sub_root->SetCount(old_sub_root->GetCount());
+            old_sub_root->SetCount(static_cast<NodeAddress>(GetCount(old_sub_root->GetLeft()) + GetCount(old_sub_root->GetRight()) + 1));
+        }
+        if constexpr (kAggregate) {
+            UpdateAggregate(old_sub_root);
+            UpdateAggregate(new_sub_root);
+        }
+    }
+
+    /*
+    * ɺֵ¼ۺֵ
+    */
+    void UpdateAggregate(Node* node) const {
+        if constexpr (kAggregate) {
+            node->SetAggregate(Monoid::Combine(
+                Monoid::Combine(GetAggregate(node->GetLeft()), Monoid::FromValue(Traits::GetValue(node->GetElement()))),
+                GetAggregate(node->GetRight())));
+        }
+    }
+
+    /*
+    * Եϸջнڵ㣬Сcount_deltaۺֵ¼
+    * ڲ/ɾڵ֮ƽ֮ǰԭ޸ֵ֮
+    */
+    void UpdatePath(const IteratorStack& stack, difference_type count_delta) const {
+        if constexpr (kOrderStatistic || kAggregate) {
+            for (size_t i = stack.size(); i-- > 0;) {
+                Node* node = allocator_.reference(stack[i]);
+                if constexpr (kOrderStatistic) {
+                    node->SetCount(static_cast<NodeAddress>(node->GetCount() + count_delta));
+                }
+                UpdateAggregate(node);
+                allocator_.dereference(node);
+            }
+        }
+    }
+
+    /*
+    * 
+    */
+    NodeAddress RotateRight(Node* sub_root_parent, NodeAddress sub_root_id, Node* sub_root) {
+        NodeAddress new_sub_root_id = sub_root->GetLeft();
+        if (new_sub_root_id == kInvalidAddress) {
+            return sub_root_id;
+        }
+        Node* new_sub_root = allocator_.reference(new_sub_root_id);
+
+        if (sub_root_parent != nullptr) {
+            ReplaceChild(sub_root_parent, sub_root_id, new_sub_root_id);
+        }
+
+        sub_root->SetLeft(new_sub_root->GetRight());
+        new_sub_root->SetRight(sub_root_id);
+        RotateAugment(sub_root, new_sub_root);
+
+        allocator_.dereference(new_sub_root);
+        return new_sub_root_id;
+    }
+    /*
+    * 
+    */
+    NodeAddress RotateLeft(Node* sub_root_parent, NodeAddress sub_root_id, Node* sub_root) {
+        NodeAddress new_sub_root_id = sub_root->GetRight();
+        if (new_sub_root_id == kInvalidAddress) {
+            return sub_root_id;
+        }
+        Node* new_sub_root = allocator_.reference(new_sub_root_id);
+
+        if (sub_root_parent != nullptr) {
+            ReplaceChild(sub_root_parent, sub_root_id, new_sub_root_id);
+        }
+
+        sub_root->SetRight(new_sub_root->GetLeft());
+        new_sub_root->SetLeft(sub_root_id);
+        RotateAugment(sub_root, new_sub_root);
 
-        sub_root->SetRight(new_sub_root->GetLeft());
-        new_sub_root->SetLeft(sub_root_id);
-
         allocator_.dereference(new_sub_root);
         return new_sub_root_id;
     }
     /*
-    * ջָnodeĸ
-    * new_nodenodeҽӵ丸ڵ
-    * new_nodeӽڵ㲻
-    * nodeժ
-    * nodeparentleftright
+    * ջָnodeĸ
+    * new_nodenodeҽӵ丸ڵ
+    * new_nodeӽڵ㲻
+    * nodeժ
+    * nodeparentleftright
+    */
+    void Hitch(Node* node_parent, NodeAddress node_id, NodeAddress new_node_id) {
+        Node* node = allocator_.reference(node_id);
+        Node* new_node = allocator_.reference(new_node_id);
+        if (node_parent != nullptr) {
+            ReplaceChild(node_parent, node_id, new_node_id);
+        }
+        if (root_ == node_id) {
+            root_ = new_node_id;
+        }
+        allocator_.dereference(node);
+        allocator_.dereference(new_node);
+    }
+    /*
+    * ȡֵܽڵ
+    */
+    NodeAddress GetSiblingNode(Node* node_parent, NodeAddress node_id, Node* node) {
+        NodeAddress ret;
+        if (node_parent->GetLeft() == node_id) {
+            ret = node_parent->GetRight();
+        }
+        else {
+            assert(node_parent->GetRight() == node_id);
+            ret = node_parent->GetLeft();
+        }
+        return ret;
+    }
+
+    /*
+    * вڵƽ
+    * ظڵĺڸǷ(һֱݵ)
+    */
+    bool InsertFixup(IteratorStack& stack, NodeAddress ins_node_id) {
+        Node* ins_node = allocator_.reference(ins_node_id);
+        ins_node->SetColor(kBlack);
+        if (stack.empty()) {
+            ins_node->SetColor(kBlack);
+            allocator_.dereference(ins_node);
+            return true;
+        }
+        bool is_grown = false;
+        auto& cur_id = stack.front(); stack.pop_back();
+
+        ins_node->SetColor(kRed);
+        allocator_.dereference(ins_node);
+
+        Node* cur = nullptr;
+        /* ʼά */
+        while (cur_id != kInvalidAddress) {
+            cur = allocator_.reference(cur_id);
+            if (cur->GetColor() == kBlack) {
+                /* ǰڵ(ڵĸڵ)Ǻɫɶ(2ڵ / 3ڵĲ룬ֱӺϲ) */
+                break;
+            }
+            if (stack.empty()) {
+                /* ûиڵ㣬ݵڵˣֱȾ */
+                cur->SetColor(kBlack);
+                is_grown = true;
+                break;
+            }
+            auto& parent_id = stack.front(); stack.pop_back();
+
+            Node* parent = allocator_.reference(parent_id);
+            NodeAddress sibling_id = GetSiblingNode(parent, cur_id, cur);
+            allocator_.dereference(parent);
+            
+            Node* sibling = nullptr;
+            if (sibling_id != kInvalidAddress) {
+                sibling = allocator_.reference(sibling_id);
+            }
+            if (sibling && sibling->GetColor() == kRed) {
+                /* ֵܽڵǺɫ˵4ڵĲ룬(־Ǳɫ)ڵϲ룬 */
+                cur->SetColor(kBlack);
+                sibling->SetColor(kBlack);
+                ins_node_id = parent_id;         /* Ϊýڵϲ */
+                ins_node = allocator_.reference(ins_node_id);
+                if (stack.empty()) {
+                    ins_node->SetColor(kBlack);     /* ڵ㣬Ⱦڲ */
+                    is_grown = true;
+                    break;
+                }
+                ins_node->SetColor(kRed);
+                parent_id = stack.front(); stack.pop_back();
+                /* parentڵ */
+            }
+            else {
+                /* ûֵܽڵֵܽڵǺɫ˵3ڵĲ룬Բ룬ҪתΪ4ڵ
+                    *        10b                                5b
+                    *     5r     20b    ->     !2r         10r
+                    * !2r                                                 20b
+                */
+                  assert(sibling_id == kInvalidAddress || sibling->GetColor() == kBlack);
+                NodeAddress new_sub_root_id;
+                NodeAddress old_sub_root_id = parent_id;
+                Node* old_sub_root = allocator_.reference(old_sub_root_id);
+                Node* new_sub_root_parent = nullptr;
+                if (!stack.empty()) {
+                    auto& new_sub_root_parent_id = stack.front();
+                    new_sub_root_parent = allocator_.reference(new_sub_root_parent_id);
+                }
+                if (old_sub_root->GetLeft() == cur_id) {
+                    if (cur->GetRight() == ins_node_id) {
+                        RotateLeft(old_sub_root, cur_id, cur);
+                    }
+                    new_sub_root_id = RotateRight(new_sub_root_parent, old_sub_root_id, old_sub_root);
+                }
+                else {
+                    if (cur->GetLeft() == ins_node_id) {
+                        RotateRight(old_sub_root, cur_id, cur);
+                    }
+                    new_sub_root_id = RotateLeft(new_sub_root_parent, old_sub_root_id, old_sub_root);
+                }
+                if (new_sub_root_parent) allocator_.dereference(new_sub_root_parent);
+                Node* new_sub_root = allocator_.reference(new_sub_root_id);
+                new_sub_root->SetColor(kBlack);
+                old_sub_root->SetColor(kRed);
+                allocator_.dereference(new_sub_root);
+
+                if (root_ == old_sub_root_id) {        /* ԭڵĸڵ㣬Ҫ */
+                    root_ = new_sub_root_id;
+                }
+                break;        /* ֻǲ룬δѣûиıɫҪ */
+            }
+            cur_id = parent_id;
+            allocator_.dereference(cur);
+        }
+        allocator_.dereference(cur);
+        return is_grown;
+    }
+    /*
+    * ɾڵƽ
+    */
+    void DeleteFixup(IteratorStack& stack, NodeAddress del_node_id, bool is_parent_left) {
+        Node* del_node = allocator_.reference(del_node_id);
+        NodeAddress parent_id = kInvalidAddress;
+
+        Color del_color = del_node->GetColor();
+        if (del_color == kRed) { /* Ǻɫģ3/4ڵ㣬ΪʱһҶӽڵ(ڵ㲻ֻһӽڵ)ֱƳ */ }
+        /* Ǻɫģһӽڵ㣬˵3ڵ㣬Ϊ2ڵ㼴 */
+        else if (del_node->GetLeft() != kInvalidAddress) {
+            Node* del_node_left = allocator_.reference(del_node->GetLeft());
+            del_node_left->SetColor(kBlack);
+            allocator_.dereference(del_node_left);
+        }
+        else if (del_node->GetRight() != kInvalidAddress) {
+            Node* del_node_right = allocator_.reference(del_node->GetRight());
+            del_node_right->SetColor(kBlack);
+            allocator_.dereference(del_node_right);
+        }
+        else {
+            if (!stack.empty()) {
+                parent_id = stack.front(); stack.pop_back();
+            }
+        }
+
+        NodeAddress new_sub_root_id;
+        NodeAddress grandpa_id = kInvalidAddress;
+        /* άɾɫڵ㣬ûӽڵ(2ڵ) */
+        Node* parent = nullptr, * sibling = nullptr, * grandpa = nullptr;
+        if (parent_id != kInvalidAddress) parent = allocator_.reference(parent_id);
+
+        while (parent_id != kInvalidAddress) {
+            NodeAddress sibling_id = is_parent_left ? parent->GetRight() : parent->GetLeft();
+            sibling = allocator_.reference(sibling_id);
+            if (!stack.empty()) {
+                grandpa_id = stack.front(); stack.pop_back();
+                grandpa = allocator_.reference(grandpa_id);
+            }
+            else {
+                grandpa_id = kInvalidAddress;
+                grandpa = nullptr;
+            }
+            /* ɫڵһֵܽڵ */
+            if (sibling->GetColor() == kRed) {
+                /* ֵܽڵΪ죬˵ֵܽڵ븸ڵγ3ڵ㣬ֵܽڵӦǺֵܽڵӽڵ
+                    תʱֻʹֵܽڵ͸ڵγɵ3ڵɫλõǰڵֵܽڵΪԭֵܽڵӽڵ */
+                NodeAddress old_sub_root_id = parent_id;
+                Node* old_sub_root = allocator_.reference(old_sub_root_id);
+                old_sub_root->SetColor(kRed);
+                sibling->SetColor(kBlack);
+                if (old_sub_root->GetLeft() == sibling_id) {
+                    new_sub_root_id = RotateRight(grandpa, old_sub_root_id, old_sub_root);
+                    sibling_id = old_sub_root->GetLeft();     /* ½ҽӹĽڵ */
+                    allocator_.dereference(sibling);
+                    sibling = allocator_.reference(sibling_id);
+                }
+                else {
+                    new_sub_root_id = RotateLeft(grandpa, old_sub_root_id, old_sub_root);
+                    sibling_id = old_sub_root->GetRight();     /* ½ҽӹĽڵ */
+                    allocator_.dereference(sibling);
+                    sibling = allocator_.reference(sibling_id);
+                }
+                if (root_ == old_sub_root_id) {
+                    root_ = new_sub_root_id;
+                }
+                allocator_.dereference(old_sub_root);
+                /* grandpaΪ¸ڵ */
+                allocator_.dereference(grandpa);
+                grandpa_id = new_sub_root_id;
+                grandpa = allocator_.reference(grandpa_id);
+            }
+
+            /* ֵܽڵһΪ */
+
+            /* ֶӽڵΪ죬ֵܽڵ3 / 4ڵֵܽڵ(ֵܽڵ㣬½׽ڵ) */
+            Node* sibling_right = allocator_.reference(sibling->GetRight());
+            Node* sibling_left = allocator_.reference(sibling->GetLeft());
+            if (sibling->GetRight() != kInvalidAddress && sibling_right->GetColor() == kRed ||
+                sibling->GetLeft() != kInvalidAddress && sibling_left->GetColor() == kRed) {
+                Color parent_color = parent->GetColor();
+                parent->SetColor(kBlack);
+                NodeAddress old_sub_root_id = parent_id;
+                Node* new_sub_root_parent = nullptr;
+                if (parent->GetLeft() == sibling_id) {
+                    if (sibling->GetLeft() == kInvalidAddress || sibling_left->GetColor() == kBlack) {
+                        sibling_right->SetColor(kBlack);
+                        sibling_id = RotateLeft(parent, sibling_id, sibling);
+                    }
+                    else {
+                        sibling_left->SetColor(kBlack);
+                    }
+                    new_sub_root_id = RotateRight(grandpa, parent_id, parent);
+                }
+                else {
+                    if (sibling->GetRight() == kInvalidAddress || sibling_right->GetColor() == kBlack) {
+                        sibling_left->SetColor(kBlack);
+                        sibling_id = RotateRight(parent, sibling_id, sibling);
+                    }
+                    else {
+                        sibling_right->SetColor(kBlack);
+                    }
+                    new_sub_root_id = RotateLeft(grandpa, parent_id, parent);
+                }
+                allocator_.dereference(sibling);
+                sibling = allocator_.reference(sibling_id);
+                /* ýڵԭȵӸڵ㣬ҲҪɫ */
+                sibling->SetColor(parent_color);
+                if (root_ == old_sub_root_id) {
+                    root_ = new_sub_root_id;
+                }
+                allocator_.dereference(sibling_right);
+                allocator_.dereference(sibling_left);
+                break;
+            }
+            allocator_.dereference(sibling_right);
+            allocator_.dereference(sibling_left);
+
+            if (parent->GetColor() == kRed) {
+                /* ڵΪ죬ڵ3/4ڵ㣬½ֵܽڵϲ
+                    |5|8|                 |5|
+                        /    |        ->        /
+                    3     6    -9-            3     |6|8| */
+                sibling->SetColor(kRed);
+                parent->SetColor(kBlack);
+                break;
+            }
+            else {
+                /* ڵΪڣڵ2ڵ㣬ֵܽڵҲ2ڵ㣬½ڵֵܽڵϲ൱ɾڵ㣬
+                    Ϊʲô3/4ڵ㣿Ϊڸڵ3ֵܽڵǺ죬4ĻʱڵǺ */
+                sibling->SetColor(kRed);
+            }
+            NodeAddress child_id = parent_id;
+            parent_id = grandpa_id;
+            allocator_.dereference(sibling);
+            sibling = nullptr;
+            allocator_.dereference(parent);
+            parent = grandpa;
+            if (parent != nullptr) {
+                is_parent_left = parent->GetLeft() == child_id;
+            }
+        }
+        allocator_.dereference(sibling);
+        allocator_.dereference(parent);
+        allocator_.dereference(del_node);
+
+        Node* root = allocator_.reference(root_);
+        if (root && root->GetColor() == kRed) {
+            /* ڵȾ */
+            root->SetColor(kBlack);
+        }
+        allocator_.dereference(root);
+    }
+
+    /*
+    * вڵ
+    * ѴڵĽڵ㷵false
     */
-    void Hitch(Node* node_parent, NodeAddress node_id, NodeAddress new_node_id) {
+    bool Insert(IteratorStack& stack, NodeAddress node_id) {
         Node* node = allocator_.reference(node_id);
-        Node* new_node = allocator_.reference(new_node_id);
-        if (node_parent != nullptr) {
-            ReplaceChild(node_parent, node_id, new_node_id);
+        stack.clear();
+
+        if (root_ == kInvalidAddress) {
+            root_ = node_id;
+            return true;
         }
-        if (root_ == node_id) {
-            root_ = new_node_id;
+        NodeAddress cur_id = root_;
+        Node* cur = nullptr;
+        bool success = true;
+        while (cur_id != kInvalidAddress) {
+            stack.push_back(cur_id);
+
+            Node* cur = allocator_.reference(cur_id);
+            const Key& cur_key = cur->GetKey();
+            const Key& find_key = node->GetKey();
+
+            std::strong_ordering ordering = CompareKey(find_key, cur_key);
+            if (ordering < 0) {
+                if (cur->GetLeft() == kInvalidAddress) {
+                    cur->SetLeft(node_id);
+                    break;
+                }
+                cur_id = cur->GetLeft();
+            }
+            else if (ordering > 0) {
+                if (cur->GetRight() == kInvalidAddress) {
+                    cur->SetRight(node_id);
+                    break;
+                }
+                cur_id = cur->GetRight();
+            }
+            else {
+                // ҵȵĽڵʱջָҵĽڵ
+                success = false;
+                break;
+            }
+            allocator_.dereference(cur);
         }
+        if (cur) allocator_.dereference(cur);
         allocator_.dereference(node);
-        allocator_.dereference(new_node);
+        return success;
     }
+
     /*
-    * ȡֵܽڵ
+    * ڵ
+    * ظkeyرǵnode_id򷵻InvalidIdnode_idѾˣҲᱻ
     */
-    NodeAddress GetSiblingNode(Node* node_parent, NodeAddress node_id, Node* node) {
-        NodeAddress ret;
-        if (node_parent->GetLeft() == node_id) {
-            ret = node_parent->GetRight();
+    NodeAddress Put(IteratorStack& stack, NodeAddress node_id) {
+        Node* node = allocator_.reference(node_id);
+        stack.clear();
+        if (root_ == kInvalidAddress) {
+            root_ = node_id;
+            return kInvalidAddress;
+        }
+        NodeAddress cur_id = root_;
+        Node* cur = NULL;
+        NodeAddress old_id = kInvalidAddress;
+        NodeAddress parent_id = kInvalidAddress;
+        while (cur_id != kInvalidAddress) {
+            stack.push_back(cur_id);
+            cur = allocator_.reference(cur_id);
+            const Key& cur_key = cur->GetKey();
+            const Key& node_key = node->GetKey();
+
+            std::strong_ordering ordering = CompareKey(node_key, cur_key);
+            if (ordering > 0) {
+                if (cur->GetRight() == kInvalidAddress) {
+                    cur->SetRight(node_id);
+                    break;
+                }
+                parent_id = cur_id;
+                cur_id = cur->GetRight();
+            }
+            else if (ordering < 0) {
+                if (cur->GetLeft() == kInvalidAddress) {
+                    cur->SetLeft(node_id);
+                    break;
+                }
+                parent_id = cur_id;
+                cur_id = cur->GetLeft();
+            }
+            else {
+                /* ȵ */
+                stack.pop_back();
+                old_id = cur_id;
+                if (cur_id == node_id) break;
+                if (parent_id != kInvalidAddress) {
+                    Node* parent = allocator_.reference(parent_id);
+                    ReplaceChild(parent, cur_id, node_id);
+                    allocator_.dereference(parent);
+                }
+                else {
+                    root_ = node_id;
+                }
+                *node = *cur;
+                break;
+            }
+            allocator_.dereference(cur);
+        }
+        if (cur) allocator_.dereference(cur);
+        allocator_.dereference(node);
+        return old_id;
+    }
+    /*
+    * ڵ
+    * ظkeyرǵԭnodeInvalidIdput_node_idѾˣҲᱻ(ֵ == put_node_id)
+    */
+    NodeAddress Put(NodeAddress put_node_id) {
+        IteratorStack stack;
+        NodeAddress old_id = Put(stack, put_node_id);
+        if (old_id == kInvalidAddress) InsertFixup(stack, put_node_id);
+        return old_id;
+    }
+
+    /*
+    * ժڵ㣬ջΪnode_id·
+    * ӽڵʱСĽڵnode_idλɫ൱ժСڵ
+    * غnode_idɫӽڵʵʱƳλãջΪλõĸڵ㣬DeleteFixupĻ
+    */
+    void Unlink(IteratorStack& stack, NodeAddress node_id, bool* is_parent_left) {
+        assert(node_id != kInvalidAddress);
+        Node* node = allocator_.reference(node_id);
+        NodeAddress parent_id = stack.empty() ? kInvalidAddress : stack.front();
+        Node* parent = nullptr;
+        if (parent_id != kInvalidAddress) {
+            parent = allocator_.reference(parent_id);
+        }
+        if (node->GetLeft() != kInvalidAddress && node->GetRight() != kInvalidAddress) {
+            /* ҵǰڵСĽڵ㣬Сڵ滻ǰڵڵλ */
+            size_t node_pos = stack.size();
+            stack.push_back(node_id);
+            NodeAddress min_node_id = node->GetRight();
+            NodeAddress min_node_parent_id = node_id;
+            Node* min_node = allocator_.reference(min_node_id);
+            while (min_node->GetLeft() != kInvalidAddress) {
+                stack.push_back(min_node_id);
+                min_node_parent_id = min_node_id;
+                min_node_id = min_node->GetLeft();
+                allocator_.dereference(min_node);
+                min_node = allocator_.reference(min_node_id);
+            }
+            NodeAddress old_right_id = min_node->GetRight();
+
+            /* Сڵ̳дɾڵΪСڵ϶ûڵ㣬ֱӸֵ */
+            min_node->SetLeft(node->GetLeft());
+            /* СڵǴɾڵҽڵ */
+            if (min_node_parent_id != node_id) {
+                /* min_nodeԭȵλժ */
+                Node* min_node_parent = allocator_.reference(min_node_parent_id);
+                min_node_parent->SetLeft(old_right_id);
+                allocator_.dereference(min_node_parent);
+                /* Сڵ̳дɾڵ */
+                min_node->SetRight(node->GetRight());
+                *is_parent_left = true;
+            }
+            else {
+                *is_parent_left = false;
+            }
+            Hitch(parent, node_id, min_node_id);
+            /* ·еnode_idѱСڵ */
+            stack[node_pos] = min_node_id;
+
+            /* ɫnodeΪԭȵmin_nodeֻǲҵ */
+            Color old_color = min_node->GetColor();
+            min_node->SetColor(node->GetColor());
+            node->SetColor(old_color);
+            if constexpr (kOrderStatistic) {
+                min_node->SetCount(node->GetCount());
+            }
+            node->SetLeft(kInvalidAddress);
+            node->SetRight(old_right_id);
+            allocator_.dereference(min_node);
         }
         else {
-            assert(node_parent->GetRight() == node_id);
-            ret = node_parent->GetLeft();
+            *is_parent_left = parent != nullptr && parent->GetLeft() == node_id;
+            /* һӽڵ㣬ֱӴ */
+            NodeAddress child_id = node->GetLeft() != kInvalidAddress ? node->GetLeft() : node->GetRight();
+            Hitch(parent, node_id, child_id);
+        }
+        if (parent) {
+            allocator_.dereference(parent);
+        }
+        allocator_.dereference(node);
+        /* ʱջǡΪʵʱƳλõȫ */
+        UpdatePath(stack, -1);
+    }
+
+    /*
+    * ɾָڵ㲢黹ڴأջΪnode_id·ʱջֻƽδ漰ǰ׺
+    */
+    void EraseNode(IteratorStack& stack, NodeAddress node_id) {
+        CheckWritable();
+        /* ֵڵһӣ/ǰժǰ󶼲 */
+        if (node_id == leftmost_) {
+            IteratorStack next_stack = stack;
+            leftmost_ = Next(next_stack, node_id);
+        }
+        if (node_id == rightmost_) {
+            IteratorStack prev_stack = stack;
+            rightmost_ = Prev(prev_stack, node_id);
+        }
+        bool is_parent_left;
+        Unlink(stack, node_id, &is_parent_left);
+        DeleteFixup(stack, node_id, is_parent_left);
+        Node* node = allocator_.reference(node_id);
+        std::destroy_at<Node>(node);
+        allocator_.dereference(node);
+        allocator_.deallocate(node_id);
+        --size_;
+        ++epoch_;
+    }
+
+    /*
+    * ɾnode_iḍջnode_id·Ϊ̵·
+    * ƽֻջʣǰ׺֮£Ҫôǰ׺УҪôǰ׺ĩ˵УӸ²
+    */
+    NodeAddress EraseNext(IteratorStack& stack, NodeAddress node_id) {
+        IteratorStack next_stack = stack;
+        NodeAddress next_id = Next(next_stack, node_id);
+        /* ظkey޷ֻȽ϶λڵ㣬¼ھ·ÿȵһ */
+        std::bitset<kMaxHeight> next_left_mask;
+        if constexpr (kMulti) {
+            for (size_t i = 0; i < next_stack.size(); ++i) {
+                NodeAddress child_id = i + 1 < next_stack.size() ? next_stack[i + 1] : next_id;
+                Node* ancestor = allocator_.reference(next_stack[i]);
+                if (ancestor->GetLeft() == child_id) {
+                    next_left_mask.set(i);
+                }
+                allocator_.dereference(ancestor);
+            }
+        }
+        EraseNode(stack, node_id);
+        if (next_id == kInvalidAddress) {
+            stack.clear();
+            return next_id;
+        }
+        for (size_t i = 0; i < stack.size(); ++i) {
+            if (stack[i] == next_id) {
+                stack.resize(i);
+                return next_id;
+            }
+        }
+        if constexpr (kMulti) {
+            RestorePathAlong(stack, next_id, next_stack, next_left_mask);
+        }
+        else {
+            RestorePath(stack, next_id);
+        }
+        return next_id;
+    }
+
+    /*
+    * ڸ(Ϊɫʱ)split/joinĻλ
+    */
+    struct SubTree {
+        NodeAddress root;
+        uint32_t black_height;
+    };
+
+    /*
+    * ͳƺɫڵ
+    */
+    uint32_t BlackHeight(NodeAddress node_id) const noexcept {
+        uint32_t height = 0;
+        while (node_id != kInvalidAddress) {
+            Node* node = allocator_.reference(node_id);
+            if (node->GetColor() == kBlack) {
+                ++height;
+            }
+            NodeAddress left_id = node->GetLeft();
+            allocator_.dereference(node);
+            node_id = left_id;
+        }
+        return height;
+    }
+
+    /*
+    * 븸ڵʱΪڣȾںڸ߼һ
+    */
+    SubTree Detach(NodeAddress node_id, uint32_t parent_black_height, bool is_parent_black) const noexcept {
+        SubTree sub{ node_id, parent_black_height - (is_parent_black ? 1 : 0) };
+        if (node_id != kInvalidAddress) {
+            Node* node = allocator_.reference(node_id);
+            if (node->GetColor() == kRed) {
+                node->SetColor(kBlack);
+                ++sub.black_height;
+            }
+            allocator_.dereference(node);
         }
-        return ret;
+        return sub;
     }
 
     /*
-    * вڵƽ
+    * ɺ¼Сۺֵ
     */
-    void InsertFixup(IteratorStack& stack, NodeAddress ins_node_id) {
-        Node* ins_node = allocator_.reference(ins_node_id);
-        ins_node->SetColor(kBlack);
-        if (stack.empty()) {
-            ins_node->SetColor(kBlack);
-            allocator_.dereference(ins_node);
-            return;
+    void UpdateAugment(Node* node) const {
+        if constexpr (kOrderStatistic) {
+            node->SetCount(static_cast<NodeAddress>(GetCount(node->GetLeft()) + GetCount(node->GetRight()) + 1));
         }
-        auto& cur_id = stack.front(); stack.pop_back();
+        UpdateAggregate(node);
+    }
 
-        ins_node->SetColor(kRed);
-        allocator_.dereference(ins_node);
+    /*
+    * pivot_idΪмڵƴøΪɫleft < pivot < right
+    * ڸͬʱpivotֱΪ¸ؽϸһı߽½ڸͬĺɫڵ㣬
+    * pivotԺɫλãٰ봦ͻO(|ڸ߲| + 1)
+    * root_InsertFixupǰָroot_
+    */
+    SubTree JoinNodes(SubTree left, NodeAddress pivot_id, SubTree right) {
+        Node* pivot = allocator_.reference(pivot_id);
+        if (left.black_height == right.black_height) {
+            pivot->SetLeft(left.root);
+            pivot->SetRight(right.root);
+            pivot->SetColor(kBlack);
+            UpdateAugment(pivot);
+            allocator_.dereference(pivot);
+            return SubTree{ pivot_id, left.black_height + 1 };
+        }
+        const bool is_left_taller = left.black_height > right.black_height;
+        SubTree& tall = is_left_taller ? left : right;
+        SubTree& low = is_left_taller ? right : left;
 
-        Node* cur = nullptr;
-        /* ʼά */
+        NodeAddress saved_root = root_;
+        root_ = tall.root;
+        IteratorStack stack;
+        NodeAddress cur_id = tall.root;
+        uint32_t height = tall.black_height;
         while (cur_id != kInvalidAddress) {
-            cur = allocator_.reference(cur_id);
+            Node* cur = allocator_.reference(cur_id);
             if (cur->GetColor() == kBlack) {
-                /* ǰڵ(ڵĸڵ)Ǻɫɶ(2ڵ / 3ڵĲ룬ֱӺϲ) */
-                break;
-            }
-            if (stack.empty()) {
-                /* ûиڵ㣬ݵڵˣֱȾ */
-                cur->SetColor(kBlack);
-                break;
-            }
-            auto& parent_id = stack.front(); stack.pop_back();
-
-            Node* parent = allocator_.reference(parent_id);
-            NodeAddress sibling_id = GetSiblingNode(parent, cur_id, cur);
-            allocator_.dereference(parent);
-            
-            Node* sibling = nullptr;
-            if (sibling_id != kInvalidAddress) {
-                sibling = allocator_.reference(sibling_id);
-            }
-            if (sibling && sibling->GetColor() == kRed) {
-                /* ֵܽڵǺɫ˵4ڵĲ룬(־Ǳɫ)ڵϲ룬 */
-                cur->SetColor(kBlack);
-                sibling->SetColor(kBlack);
-                ins_node_id = parent_id;         /* Ϊýڵϲ */
-                ins_node = allocator_.reference(ins_node_id);
-                if (stack.empty()) {
-                    ins_node->SetColor(kBlack);     /* ڵ㣬Ⱦڲ */
+                if (height == low.black_height) {
+                    allocator_.dereference(cur);
                     break;
                 }
-                ins_node->SetColor(kRed);
-                parent_id = stack.front(); stack.pop_back();
-                /* parentڵ */
-            }
-            else {
-                /* ûֵܽڵֵܽڵǺɫ˵3ڵĲ룬Բ룬ҪתΪ4ڵ
-                    *        10b                                5b
-                    *     5r     20b    ->     !2r         10r
-                    * !2r                                                 20b
-                */
-                  assert(sibling_id == kInvalidAddress || sibling->GetColor() == kBlack);
-                NodeAddress new_sub_root_id;
-                NodeAddress old_sub_root_id = parent_id;
-                Node* old_sub_root = allocator_.reference(old_sub_root_id);
-                Node* new_sub_root_parent = nullptr;
-                if (!stack.empty()) {
-                    auto& new_sub_root_parent_id = stack.front();
-                    new_sub_root_parent = allocator_.reference(new_sub_root_parent_id);
-                }
-                if (old_sub_root->GetLeft() == cur_id) {
-                    if (cur->GetRight() == ins_node_id) {
-                        RotateLeft(old_sub_root, cur_id, cur);
-                    }
-                    new_sub_root_id = RotateRight(new_sub_root_parent, old_sub_root_id, old_sub_root);
-                }
-                else {
-                    if (cur->GetLeft() == ins_node_id) {
-                        RotateRight(old_sub_root, cur_id, cur);
-                    }
-                    new_sub_root_id = RotateLeft(new_sub_root_parent, old_sub_root_id, old_sub_root);
-                }
-                if (new_sub_root_parent) allocator_.dereference(new_sub_root_parent);
-                Node* new_sub_root = allocator_.reference(new_sub_root_id);
-                new_sub_root->SetColor(kBlack);
-                old_sub_root->SetColor(kRed);
-                allocator_.dereference(new_sub_root);
-
-                if (root_ == old_sub_root_id) {        /* ԭڵĸڵ㣬Ҫ */
-                    root_ = new_sub_root_id;
-                }
-                break;        /* ֻǲ룬δѣûиıɫҪ */
+                --height;
             }
-            cur_id = parent_id;
+            stack.push_back(cur_id);
+            cur_id = is_left_taller ? cur->GetRight() : cur->GetLeft();
             allocator_.dereference(cur);
         }
-        allocator_.dereference(cur);
+        assert(!stack.empty());
+        if (is_left_taller) {
+            pivot->SetLeft(cur_id);
+            pivot->SetRight(low.root);
+        }
+        else {
+            pivot->SetLeft(low.root);
+            pivot->SetRight(cur_id);
+        }
+        UpdateAugment(pivot);
+        allocator_.dereference(pivot);
+        Node* parent = allocator_.reference(stack.front());
+        if (is_left_taller) {
+            parent->SetRight(pivot_id);
+        }
+        else {
+            parent->SetLeft(pivot_id);
+        }
+        allocator_.dereference(parent);
+
+        difference_type count_delta = 0;
+        if constexpr (kOrderStatistic) {
+            count_delta = static_cast<difference_type>(GetCount(low.root) + 1);
+        }
+        UpdatePath(stack, count_delta);
+        bool is_grown = InsertFixup(stack, pivot_id);
+        SubTree joined{ root_, tall.black_height + (is_grown ? 1 : 0) };
+        root_ = saved_root;
+        return joined;
     }
+
     /*
-    * ɾڵƽ
+    * ΪСkey벻Сkey֣ز·ԵƴӣܴO(log n)
     */
-    void DeleteFixup(IteratorStack& stack, NodeAddress del_node_id, bool is_parent_left) {
-        Node* del_node = allocator_.reference(del_node_id);
-        NodeAddress parent_id = kInvalidAddress;
-
-        Color del_color = del_node->GetColor();
-        if (del_color == kRed) { /* Ǻɫģ3/4ڵ㣬ΪʱһҶӽڵ(ڵ㲻ֻһӽڵ)ֱƳ */ }
-        /* Ǻɫģһӽڵ㣬˵3ڵ㣬Ϊ2ڵ㼴 */
-        else if (del_node->GetLeft() != kInvalidAddress) {
-            Node* del_node_left = allocator_.reference(del_node->GetLeft());
-            del_node_left->SetColor(kBlack);
-            allocator_.dereference(del_node_left);
+    template <class K>
+    std::pair<SubTree, SubTree> SplitNodes(SubTree tree, const K& key) {
+        if (tree.root == kInvalidAddress) {
+            return { tree, tree };
         }
-        else if (del_node->GetRight() != kInvalidAddress) {
-            Node* del_node_right = allocator_.reference(del_node->GetRight());
-            del_node_right->SetColor(kBlack);
-            allocator_.dereference(del_node_right);
+        Node* node = allocator_.reference(tree.root);
+        bool is_black = node->GetColor() == kBlack;
+        bool is_less = CompareKey(node->GetKey(), key) < 0;
+        SubTree left = Detach(node->GetLeft(), tree.black_height, is_black);
+        SubTree right = Detach(node->GetRight(), tree.black_height, is_black);
+        allocator_.dereference(node);
+        if (is_less) {
+            auto [less, not_less] = SplitNodes(right, key);
+            return { JoinNodes(left, tree.root, less), not_less };
         }
         else {
-            if (!stack.empty()) {
-                parent_id = stack.front(); stack.pop_back();
-            }
+            auto [less, not_less] = SplitNodes(left, key);
+            return { less, JoinNodes(not_less, tree.root, right) };
         }
+    }
 
-        NodeAddress new_sub_root_id;
-        NodeAddress grandpa_id = kInvalidAddress;
-        /* άɾɫڵ㣬ûӽڵ(2ڵ) */
-        Node* parent = nullptr, * sibling = nullptr, * grandpa = nullptr;
-        if (parent_id != kInvalidAddress) parent = allocator_.reference(parent_id);
-
-        while (parent_id != kInvalidAddress) {
-            NodeAddress sibling_id = is_parent_left ? parent->GetRight() : parent->GetLeft();
-            sibling = allocator_.reference(sibling_id);
-            if (!stack.empty()) {
-                grandpa_id = stack.front(); stack.pop_back();
-                grandpa = allocator_.reference(grandpa_id);
-            }
-            else grandpa = nullptr;
-            /* ɫڵһֵܽڵ */
-            if (sibling->GetColor() == kRed) {
-                /* ֵܽڵΪ죬˵ֵܽڵ븸ڵγ3ڵ㣬ֵܽڵӦǺֵܽڵӽڵ
-                    תʱֻʹֵܽڵ͸ڵγɵ3ڵɫλõǰڵֵܽڵΪԭֵܽڵӽڵ */
-                NodeAddress old_sub_root_id = parent_id;
-                Node* old_sub_root = allocator_.reference(old_sub_root_id);
-                old_sub_root->SetColor(kRed);
-                sibling->SetColor(kBlack);
-                if (old_sub_root->GetLeft() == sibling_id) {
-                    new_sub_root_id = RotateRight(grandpa, old_sub_root_id, old_sub_root);
-                    sibling_id = old_sub_root->GetLeft();     /* ½ҽӹĽڵ */
-                    allocator_.dereference(sibling);
-                    sibling = allocator_.reference(sibling_id);
-                }
-                else {
-                    new_sub_root_id = RotateLeft(grandpa, old_sub_root_id, old_sub_root);
-                    sibling_id = old_sub_root->GetRight();     /* ½ҽӹĽڵ */
-                    allocator_.dereference(sibling);
-                    sibling = allocator_.reference(sibling_id);
-                }
-                if (root_ == old_sub_root_id) {
-                    root_ = new_sub_root_id;
-                }
-                allocator_.dereference(old_sub_root);
-                /* grandpaΪ¸ڵ */
-                allocator_.dereference(grandpa);
-                grandpa_id = new_sub_root_id;
-                grandpa = allocator_.reference(grandpa_id);
-            }
-
-            /* ֵܽڵһΪ */
-
-            /* ֶӽڵΪ죬ֵܽڵ3 / 4ڵֵܽڵ(ֵܽڵ㣬½׽ڵ) */
-            Node* sibling_right = allocator_.reference(sibling->GetRight());
-            Node* sibling_left = allocator_.reference(sibling->GetLeft());
-            if (sibling->GetRight() != kInvalidAddress && sibling_right->GetColor() == kRed ||
-                sibling->GetLeft() != kInvalidAddress && sibling_left->GetColor() == kRed) {
-                Color parent_color = parent->GetColor();
-                parent->SetColor(kBlack);
-                NodeAddress old_sub_root_id = parent_id;
-                Node* new_sub_root_parent = nullptr;
-                if (parent->GetLeft() == sibling_id) {
-                    if (sibling->GetLeft() == kInvalidAddress || sibling_left->GetColor() == kBlack) {
-                        sibling_right->SetColor(kBlack);
-                        sibling_id = RotateLeft(parent, sibling_id, sibling);
-                    }
-                    else {
-                        sibling_left->SetColor(kBlack);
-                    }
-                    new_sub_root_id = RotateRight(grandpa, parent_id, parent);
-                }
-                else {
-                    if (sibling->GetRight() == kInvalidAddress || sibling_right->GetColor() == kBlack) {
-                        sibling_left->SetColor(kBlack);
-                        sibling_id = RotateRight(parent, sibling_id, sibling);
-                    }
-                    else {
-                        sibling_right->SetColor(kBlack);
-                    }
-                    new_sub_root_id = RotateLeft(grandpa, parent_id, parent);
-                }
-                allocator_.dereference(sibling);
-                sibling = allocator_.reference(sibling_id);
-                /* ýڵԭȵӸڵ㣬ҲҪɫ */
-                sibling->SetColor(parent_color);
-                if (root_ == old_sub_root_id) {
-                    root_ = new_sub_root_id;
-                }
-                allocator_.dereference(sibling_right);
-                allocator_.dereference(sibling_left);
-                break;
-            }
-            allocator_.dereference(sibling_right);
-            allocator_.dereference(sibling_left);
+    /*
+    * ռԪصĵַ
+    */
+    std::vector<value_type*> CollectValues(NodeAddress sub_root_id) const {
+        std::vector<value_type*> values;
+        if (sub_root_id == kInvalidAddress) {
+            return values;
+        }
+        IteratorStack stack;
+        NodeAddress node_id = LeftMost(stack, sub_root_id);
+        while (node_id != kInvalidAddress) {
+            values.push_back(&GetValue(node_id));
+            node_id = Next(stack, node_id);
+        }
+        return values;
+    }
 
-            if (parent->GetColor() == kRed) {
-                /* ڵΪ죬ڵ3/4ڵ㣬½ֵܽڵϲ
-                    |5|8|                 |5|
-                        /    |        ->        /
-                    3     6    -9-            3     |6|8| */
-                sibling->SetColor(kRed);
-                parent->SetColor(kBlack);
-                break;
-            }
-            else {
-                /* ڵΪڣڵ2ڵ㣬ֵܽڵҲ2ڵ㣬½ڵֵܽڵϲ൱ɾڵ㣬
-                    Ϊʲô3/4ڵ㣿Ϊڸڵ3ֵܽڵǺ죬4ĻʱڵǺ */
-                sibling->SetColor(kRed);
-            }
-            NodeAddress child_id = parent_id;
-            parent_id = grandpa_id;
-            allocator_.dereference(parent);
-            parent = grandpa;
-            if (parent != nullptr) {
-                is_parent_left = parent->GetLeft() == child_id;
+    /*
+    * нСһǷΪaڵ(ʱaΪС)
+    * δkOrderStatisticʱСһñ꼴ֹͣO(СһõĴС)
+    */
+    std::pair<bool, size_type> CountSmaller(NodeAddress a_id, NodeAddress b_id) const noexcept {
+        if constexpr (kOrderStatistic) {
+            size_type a_count = GetCount(a_id), b_count = GetCount(b_id);
+            return a_count <= b_count ? std::pair{ true, a_count } : std::pair{ false, b_count };
+        }
+        else {
+            IteratorStack a_stack, b_stack;
+            if (a_id != kInvalidAddress) a_stack.push_back(a_id);
+            if (b_id != kInvalidAddress) b_stack.push_back(b_id);
+            auto visit = [this](IteratorStack& stack) {
+                NodeAddress node_id = stack.front(); stack.pop_back();
+                Node* node = allocator_.reference(node_id);
+                if (node->GetRight() != kInvalidAddress) stack.push_back(node->GetRight());
+                if (node->GetLeft() != kInvalidAddress) stack.push_back(node->GetLeft());
+                allocator_.dereference(node);
+            };
+            size_type count = 0;
+            while (!a_stack.empty() && !b_stack.empty()) {
+                visit(a_stack);
+                visit(b_stack);
+                ++count;
             }
+            return { a_stack.empty(), count };
         }
-        allocator_.dereference(sibling);
-        allocator_.dereference(parent);
+    }
 
-        Node* root = allocator_.reference(root_);
-        if (root && root->GetColor() == kRed) {
-            /* ڵȾ */
-            root->SetColor(kBlack);
+    /*
+    * еԪزڵ黹ڴ
+    */
+    void FreeSubtree(NodeAddress sub_root_id) noexcept {
+        if (sub_root_id == kInvalidAddress) {
+            return;
+        }
+        IteratorStack stack;
+        stack.push_back(sub_root_id);
+        while (!stack.empty()) {
+            NodeAddress node_id = stack.front(); stack.pop_back();
+            Node* node = allocator_.reference(node_id);
+            if (node->GetRight() != kInvalidAddress) stack.push_back(node->GetRight());
+            if (node->GetLeft() != kInvalidAddress) stack.push_back(node->GetLeft());
+            std::destroy_at<Node>(node);
+            allocator_.dereference(node);
+            allocator_.deallocate(node_id);
         }
-        allocator_.dereference(root);
     }
 
     /*
-    * вڵ
-    * ѴڵĽڵ㷵false
+    * ڱڴvalues[first, last)һöroot_size_
     */
-    bool Insert(IteratorStack& stack, NodeAddress node_id) {
-        Node* node = allocator_.reference(node_id);
-        stack.clear();
+    SubTree BuildDetached(const std::vector<value_type*>& values, size_t first, size_t last) {
+        NodeAddress saved_root = root_;
+        NodeAddress saved_leftmost = leftmost_;
+        NodeAddress saved_rightmost = rightmost_;
+        size_type saved_size = size_;
+        root_ = kInvalidAddress;
+        size_ = 0;
+        try {
+            BuildSorted(static_cast<size_type>(last - first), [&](size_type i) -> value_type&& {
+                return std::move(*values[first + i]);
+            });
+        }
+        catch (...) {
+            FreeSubtree(root_);
+            root_ = saved_root;
+            leftmost_ = saved_leftmost;
+            rightmost_ = saved_rightmost;
+            size_ = saved_size;
+            throw;
+        }
+        SubTree sub{ root_, BlackHeight(root_) };
+        root_ = saved_root;
+        leftmost_ = saved_leftmost;
+        rightmost_ = saved_rightmost;
+        size_ = saved_size;
+        return sub;
+    }
 
+    template <class K>
+    void SplitTree(const K& key, RbTree& right) {
+        if (&right == this) {
+            return;
+        }
+        CheckWritable();
+        right.CheckWritable();
+        right.clear();
         if (root_ == kInvalidAddress) {
-            root_ = node_id;
-            return true;
+            return;
         }
-        NodeAddress cur_id = root_;
-        Node* cur = nullptr;
-        bool success = true;
-        while (cur_id != kInvalidAddress) {
-            stack.push_back(cur_id);
-
-            Node* cur = allocator_.reference(cur_id);
-            Key& cur_key = cur->GetElement().key;
-            Key& find_key = node->GetElement().key;
+        auto [less, not_less] = SplitNodes(SubTree{ root_, BlackHeight(root_) }, key);
+        ++epoch_;
+        compact_.reset();
+        if (IsSameArena(right)) {
+            /* ͬһarenaֱӰѲСkeyһཻrightƶԪأֻ֪ĴС */
+            auto [is_less_smaller, smaller_size] = CountSmaller(less.root, not_less.root);
+            size_type moved_size = is_less_smaller ? size_ - smaller_size : smaller_size;
+            root_ = less.root;
+            size_ -= moved_size;
+            right.root_ = not_less.root;
+            right.size_ = moved_size;
+            ResetBounds();
+            right.ResetBounds();
+            return;
+        }
+        /* ֻƶСһ࣬ļӳڴزƶСkeyһ */
+        bool is_move_less = false;
+        if constexpr (!kMapped) {
+            is_move_less = CountSmaller(less.root, not_less.root).first;
+        }
+        SubTree moved = is_move_less ? less : not_less;
+        root_ = is_move_less ? not_less.root : less.root;
+        auto values = CollectValues(moved.root);
+        right.BuildSorted(static_cast<size_type>(values.size()), [&](size_type i) -> value_type&& {
+            return std::move(*values[i]);
+        });
+        FreeSubtree(moved.root);
+        size_ -= static_cast<size_type>(values.size());
+        ResetBounds();
+        if (is_move_less) {
+            /* СһrightʹСkeyĲ */
+            RbTree tmp = std::move(right);
+            right = std::move(*this);
+            *this = std::move(tmp);
+        }
+    }
 
-            std::strong_ordering ordering = find_key <=> cur_key;;
-            if (ordering < 0) {
-            // if (key_compare{}(find_key, cur_key)) {
-                if (cur->GetLeft() == kInvalidAddress) {
-                    cur->SetLeft(node_id);
-                    break;
-                }
-                cur_id = cur->GetLeft();
-            }
-            else if (ordering > 0) {
-            // else if (key_compare{}(cur_key, find_key)) {
-                if (cur->GetRight() == kInvalidAddress) {
-                    cur->SetRight(node_id);
-                    break;
-                }
-                cur_id = cur->GetRight();
+    /*
+    * СһԪƶһڴйٰڸƴ
+    * ûиpivotʱȡƶһ࿿ƴӴԪΪpivot
+    * ļӳڴزǽright뱾
+    * ͬһarenaʱֱӰڸƴӣֻpivotҪ½ڵ
+    */
+    template <class... Pivot>
+    void JoinTree(RbTree&& right, Pivot&&... pivot) {
+        CheckWritable();
+        right.CheckWritable();
+        if (IsSameArena(right)) {
+            NodeAddress pivot_id;
+            if constexpr (sizeof...(Pivot) == 1) {
+                pivot_id = CreateNode(std::forward<Pivot>(pivot)...);
             }
             else {
-                // ҵȵĽڵʱջָҵĽڵ
-                success = false;
-                break;
+                pivot_id = CreateNode(std::move(right.GetValue(std::get<0>(right.First()))));
+                right.erase(right.begin());
             }
-            allocator_.dereference(cur);
+            SubTree joined = JoinNodes(SubTree{ root_, BlackHeight(root_) }, pivot_id, SubTree{ right.root_, BlackHeight(right.root_) });
+            root_ = joined.root;
+            size_ += right.size_ + 1;
+            ++epoch_;
+            compact_.reset();
+            ResetBounds();
+            right.root_ = kInvalidAddress;
+            right.leftmost_ = kInvalidAddress;
+            right.rightmost_ = kInvalidAddress;
+            right.size_ = 0;
+            ++right.epoch_;
+            right.compact_.reset();
+            return;
+        }
+        bool is_adopt_right = kMapped || right.size_ <= size_;
+        RbTree& dst = is_adopt_right ? *this : right;
+        RbTree& src = is_adopt_right ? right : *this;
+        auto values = src.CollectValues(src.root_);
+        size_t first = 0, last = values.size();
+        NodeAddress pivot_id;
+        if constexpr (sizeof...(Pivot) == 1) {
+            pivot_id = dst.CreateNode(std::forward<Pivot>(pivot)...);
+        }
+        else {
+            pivot_id = dst.CreateNode(std::move(*values[is_adopt_right ? first++ : --last]));
+        }
+        SubTree sub;
+        try {
+            sub = dst.BuildDetached(values, first, last);
+        }
+        catch (...) {
+            dst.FreeSubtree(pivot_id);
+            throw;
+        }
+        SubTree kept{ dst.root_, dst.BlackHeight(dst.root_) };
+        SubTree joined = is_adopt_right ? dst.JoinNodes(kept, pivot_id, sub) : dst.JoinNodes(sub, pivot_id, kept);
+        dst.root_ = joined.root;
+        dst.size_ += static_cast<size_type>(values.size() + sizeof...(Pivot));
+        dst.ResetBounds();
+        ++dst.epoch_;
+        dst.compact_.reset();
+        src.clear();
+        if (!is_adopt_right) {
+            *this = std::move(right);
         }
-        if (cur) allocator_.dereference(cur);
-        allocator_.dereference(node);
-        return success;
     }
 
     /*
-    * ڵ
-    * ظkeyرǵnode_id򷵻InvalidIdnode_idѾˣҲᱻ
+    * иԪǷֻڱСֻotherС߶
     */
-    NodeAddress Put(IteratorStack& stack, NodeAddress node_id) {
-        Node* node = allocator_.reference(node_id);
-        stack.clear();
-        if (root_ == kInvalidAddress) {
-            root_ = node_id;
-            return kInvalidAddress;
-        }
-        NodeAddress cur_id = root_;
-        Node* cur = NULL;
-        NodeAddress old_id = kInvalidAddress;
-        NodeAddress parent_id = kInvalidAddress;
-        while (cur_id != kInvalidAddress) {
-            stack.push_back(cur_id);
-            cur = allocator_.reference(cur_id);
-            Key& cur_key = cur->GetElement().key;
-            Key& node_key = node->GetElement().key;
+    struct SetOperationPlan {
+        bool keep_only_mine;
+        bool keep_only_other;
+        bool keep_both;
+    };
 
-            //auto ordering = cur_key <=> node_key;
-            //if (ordering < 0) {
-            if (key_compare{}(cur_key, node_key)) {
-                if (cur->GetRight() == kInvalidAddress) {
-                    cur->SetRight(node_id);
-                    break;
-                }
-                parent_id = cur_id;
-                cur_id = cur->GetRight();
+    /*
+    * εa뱻ֵba_is_mineʾaǷΪ
+    */
+    struct SetOperationContext {
+        const RbTree& a;
+        const RbTree& b;
+        bool keep_a;
+        bool keep_b;
+        bool keep_both;
+        bool a_is_mine;
+        uint32_t parallel_depth;
+    };
+
+    /* ϼƴﵽùģŲУ̵߳Ŀ */
+    static constexpr size_t kParallelThreshold = size_t{ 1 } << 16;
+
+    /*
+    * (lo, hi)nullptrʾ޽
+    */
+    static bool InOpenRange(const Key& key, const Key* lo, const Key* hi) {
+        return (lo == nullptr || CompareKey(key, *lo) > 0) && (hi == nullptr || CompareKey(key, *hi) < 0);
+    }
+
+    /*
+    * sub_root_idҵһ(lo, hi)еĽڵ㣬½ʱųĶһ࣬ڵȫڵ
+    */
+    NodeAddress RangeRoot(NodeAddress sub_root_id, const Key* lo, const Key* hi) const {
+        NodeAddress cur_id = sub_root_id;
+        while (cur_id != kInvalidAddress) {
+            Node* cur = allocator_.reference(cur_id);
+            NodeAddress next_id;
+            if (lo != nullptr && CompareKey(cur->GetKey(), *lo) <= 0) {
+                next_id = cur->GetRight();
             }
-            //else if (ordering > 0) {
-            else if (key_compare{}(node_key, cur_key)) {
-                if (cur->GetLeft() == kInvalidAddress) {
-                    cur->SetLeft(node_id);
-                    break;
-                }
-                parent_id = cur_id;
-                cur_id = cur->GetLeft();
+            else if (hi != nullptr && CompareKey(cur->GetKey(), *hi) >= 0) {
+                next_id = cur->GetLeft();
             }
             else {
-                /* ȵ */
-                stack.pop_back();
-                old_id = cur_id;
-                if (cur_id == node_id) break;
-                if (parent_id != kInvalidAddress) {
-                    Node* parent = allocator_.reference(parent_id);
-                    ReplaceChild(parent, cur_id, node_id);
-                    allocator_.dereference(parent);
-                }
-                else {
-                    root_ = node_id;
-                }
-                *node = *cur;
+                allocator_.dereference(cur);
                 break;
             }
             allocator_.dereference(cur);
+            cur_id = next_id;
         }
-        if (cur) allocator_.dereference(cur);
-        allocator_.dereference(node);
-        return old_id;
+        return cur_id;
     }
+
     /*
-    * ڵ
-    * ظkeyرǵԭnodeInvalidIdput_node_idѾˣҲᱻ(ֵ == put_node_id)
+    * (lo, hi)ڵԪأֱӼȥ
     */
-    NodeAddress Put(NodeAddress put_node_id) {
-        IteratorStack stack;
-        NodeAddress old_id = Put(stack, put_node_id);
-        if (old_id == kInvalidAddress) InsertFixup(stack, put_node_id);
-        return old_id;
+    void CollectRange(NodeAddress node_id, const Key* lo, const Key* hi, std::vector<const value_type*>& out) const {
+        if (node_id == kInvalidAddress) {
+            return;
+        }
+        Node* node = allocator_.reference(node_id);
+        const Key& key = node->GetKey();
+        bool is_above_lo = lo == nullptr || CompareKey(key, *lo) > 0;
+        bool is_below_hi = hi == nullptr || CompareKey(key, *hi) < 0;
+        if (is_above_lo) {
+            CollectRange(node->GetLeft(), lo, hi, out);
+        }
+        if (is_above_lo && is_below_hi) {
+            out.push_back(&Traits::GetValue(node->GetElement()));
+        }
+        if (is_below_hi) {
+            CollectRange(node->GetRight(), lo, hi, out);
+        }
+        allocator_.dereference(node);
     }
 
     /*
-    * ɾڵ
-    * رɾĽڵ(滻ǰλõСڵ)л
+    * a_idΪb_idΪbа(lo, hi)ȫڵ
     */
-    NodeAddress Delete(IteratorStack& stack, NodeAddress node_id, bool* is_parent_left) {
-        assert(node_id != kInvalidAddress);
-        Node* node = allocator_.reference(node_id);
-        if (stack.empty()) {
-            return kInvalidAddress;
+    static void SetOperationStep(const SetOperationContext& ctx, NodeAddress a_id, NodeAddress b_id,
+        const Key* lo, const Key* hi, std::vector<const value_type*>& out, uint32_t depth) {
+        if (a_id == kInvalidAddress) {
+            if (ctx.keep_b) {
+                ctx.b.CollectRange(b_id, lo, hi, out);
+            }
+            return;
         }
-        NodeAddress& parent_id = stack.front(); stack.pop_back();
-        Node* parent = NULL;
-        if (parent_id != NULL) {
-            assert(*parent_id != kInvalidAddress);
-            parent = allocator_.reference(parent_id);
+        if (b_id == kInvalidAddress) {
+            if (ctx.keep_a) {
+                ctx.a.CollectRange(a_id, nullptr, nullptr, out);
+            }
+            return;
         }
-        if (node->GetLeft() != kInvalidAddress && node->GetRight() != kInvalidAddress) {
-            /* Ҹӽڵ㣬ҵǰڵСĽڵ㣬Сڵ滻ǰڵڵλãժǰڵ㣬൱ƳСڵ */
-            stack.push_back(node_id);
-            NodeAddress new_node_id = stack.front();
-            NodeAddress min_node_id = node->GetRight();
-            NodeAddress min_node_parent_id = kInvalidAddress;
-            Node* min_node = allocator_.reference(min_node_id);
-            while (min_node->GetLeft() != kInvalidAddress) {
-                stack.push_back(min_node_id);
-                min_node_parent_id = min_node_id;
-                min_node_id = min_node->GetLeft();
-                allocator_.dereference(min_node);
-                min_node = allocator_.reference(min_node_id);
+        Node* a_node = ctx.a.allocator_.reference(a_id);
+        const Key& key = a_node->GetKey();
+        const value_type* a_value = &Traits::GetValue(a_node->GetElement());
+        NodeAddress a_left_id = a_node->GetLeft(), a_right_id = a_node->GetRight();
+
+        /* keybеĽڵ㣬ԼbỮֺ */
+        NodeAddress equal_id = ctx.b.RangeRoot(b_id, lo, hi);
+        while (equal_id != kInvalidAddress) {
+            Node* b_node = ctx.b.allocator_.reference(equal_id);
+            std::strong_ordering ordering = CompareKey(key, b_node->GetKey());
+            NodeAddress next_id = ordering < 0 ? b_node->GetLeft() : b_node->GetRight();
+            ctx.b.allocator_.dereference(b_node);
+            if (ordering == 0) {
+                break;
             }
-            /* 滻ǰλõСڵ㣬֤·ȷ */
-            new_node_id = min_node_id;
-            Node* min_node_parent = allocator_.reference(min_node_parent_id);
+            equal_id = next_id;
+        }
+        NodeAddress b_left_id = ctx.b.RangeRoot(b_id, lo, &key);
+        NodeAddress b_right_id = ctx.b.RangeRoot(b_id, &key, hi);
 
-            /* Сڵ̳дɾڵΪСڵ϶ûڵ㣬ֱӸֵ */
-            min_node->SetLeft(node->GetLeft());
+        const value_type* mid = nullptr;
+        if (equal_id != kInvalidAddress) {
+            if (ctx.keep_both) {
+                mid = ctx.a_is_mine ? a_value : &ctx.b.GetValue(equal_id);
+            }
+        }
+        else if (ctx.keep_a) {
+            mid = a_value;
+        }
 
-            NodeAddress old_right_id = min_node->GetRight();
-            /* СڵǴɾڵҽڵ */
-            if (node->GetRight() != min_node_id) {
-                /* min_nodeԭȵλժ */
-                min_node_parent->SetLeft(min_node->GetRight());
+        if (depth < ctx.parallel_depth) {
+            std::vector<const value_type*> right_out;
+            auto right_task = std::async(std::launch::async, [&] {
+                SetOperationStep(ctx, a_right_id, b_right_id, &key, hi, right_out, depth + 1);
+            });
+            SetOperationStep(ctx, a_left_id, b_left_id, lo, &key, out, depth + 1);
+            if (mid) {
+                out.push_back(mid);
+            }
+            right_task.get();
+            out.insert(out.end(), right_out.begin(), right_out.end());
+        }
+        else {
+            SetOperationStep(ctx, a_left_id, b_left_id, lo, &key, out, depth + 1);
+            if (mid) {
+                out.push_back(mid);
+            }
+            SetOperationStep(ctx, a_right_id, b_right_id, &key, hi, out, depth + 1);
+        }
+        ctx.a.allocator_.dereference(a_node);
+    }
 
-                /* Сڵ̳дɾڵ */
-                min_node->SetRight(node->GetRight());
-                if (is_parent_left) *is_parent_left = true;
+    void SetOperation(const RbTree& other, SetOperationPlan plan) {
+        CheckWritable();
+        /* (ȫ)(ֻ)ȫ󲿷ԪأotherСʱֻɾ */
+        if (plan.keep_only_mine && &other != this && size_t{ other.size_ } * std::bit_width(size_t{ size_ }) < size_) {
+            if (plan.keep_only_other) {
+                insert_sorted(other.begin(), other.end());
             }
             else {
-                if (is_parent_left) *is_parent_left = false;
+                for (const value_type& value : other) {
+                    erase(Traits::GetKey(value));
+                }
             }
-            allocator_.dereference(min_node_parent);
-
-            /* йҽ */
-            Hitch(parent, node_id, min_node_id);
-
-            /* Ҳѡֱӽڵݣǿ */
-
-            node_id = min_node_id;
-
-            /* ݿҪģnodeΪԭȵmin_nodeֻǲҵ(nodeĸڵ㲻ָnode) */
-            node->SetLeft(kInvalidAddress);
-            node->SetRight(old_right_id);
+            return;
+        }
+        /* ԽСΪ */
+        bool a_is_mine = size_ <= other.size_;
+        uint32_t parallel_depth = 0;
+        if (size_t{ size_ } + other.size_ >= kParallelThreshold) {
+            parallel_depth = static_cast<uint32_t>(std::bit_width(std::max(1u, std::thread::hardware_concurrency())));
+        }
+        SetOperationContext ctx{
+            a_is_mine ? *this : other,
+            a_is_mine ? other : *this,
+            a_is_mine ? plan.keep_only_mine : plan.keep_only_other,
+            a_is_mine ? plan.keep_only_other : plan.keep_only_mine,
+            plan.keep_both,
+            a_is_mine,
+            parallel_depth,
+        };
+        std::vector<const value_type*> out;
+        SetOperationStep(ctx, ctx.a.root_, ctx.b.root_, nullptr, nullptr, out, 0);
+
+        if constexpr (kMapped) {
+            /* ӳڴز滻ȸƳԭؽ */
+            std::vector<value_type> values;
+            values.reserve(out.size());
+            for (auto value : out) {
+                values.push_back(*value);
+            }
+            clear();
+            BuildSorted(static_cast<size_type>(values.size()), [&](size_type i) -> const value_type& {
+                return values[i];
+            });
         }
         else {
-            if (is_parent_left) {
-                if (parent != NULL) {
-                    *is_parent_left = parent->GetLeft() == node_id;
-                    assert(*is_parent_left || *is_parent_left == false && parent->GetRight() == node_id);
-                }
-                else {
-                    *is_parent_left = false;
+            RbTree result(NewPool());
+            result.BuildSorted(static_cast<size_type>(out.size()), [&](size_type i) -> const value_type& {
+                return *out[i];
+            });
+            *this = std::move(result);
+        }
+    }
+
+    void CheckJoinOrder(const Key& left, const Key& right) const {
+        std::strong_ordering ordering = CompareKey(left, right);
+        if (ordering > 0 || (!kMulti && ordering == 0)) {
+            throw std::invalid_argument("join requires all keys of the left tree to precede the right tree");
+        }
+    }
+
+    /*
+    * RestorePathͬkeyʱnode_idɾǰľ·жϷ
+    * תı䣬node_idλھ·ϸȵһʼճ
+    * תȶԱɾλõֵһ࣬㣬³node_idһ
+    * ܿͻnode_id·ϵĽڵ㣬һ򲻻
+    */
+    void RestorePathAlong(IteratorStack& stack, NodeAddress node_id, const IteratorStack& old_stack, const std::bitset<kMaxHeight>& old_left_mask) const noexcept {
+        auto old_pos = [&](NodeAddress id) {
+            for (size_t i = 0; i < old_stack.size(); ++i) {
+                if (old_stack[i] == id) {
+                    return i;
                 }
             }
-
-            if (node->GetRight() != kInvalidAddress) {
-                /* ֻӽڵ */
-                Hitch(parent, node_id, node->GetRight());
+            return old_stack.size();
+        };
+        auto leads_to = [&](auto& self, NodeAddress id, int depth) -> bool {
+            if (id == kInvalidAddress) {
+                return false;
             }
-            else if (node->GetLeft() != kInvalidAddress) {
-                /* ֻӽڵ */
-                Hitch(parent, node_id, node->GetLeft());
+            if (id == node_id || old_pos(id) < old_stack.size()) {
+                return true;
             }
-            else {
-                /* ûӽڵ㣬ֱӴӸڵժ˽ڵ */
-                Hitch(parent, node_id, kInvalidAddress);
+            if (depth == 0) {
+                return false;
             }
+            Node* sub = allocator_.reference(id);
+            NodeAddress left_id = sub->GetLeft(), right_id = sub->GetRight();
+            allocator_.dereference(sub);
+            return self(self, left_id, depth - 1) || self(self, right_id, depth - 1);
+        };
+        NodeAddress cur_id = root_;
+        if (!stack.empty()) {
+            cur_id = stack.front(); stack.pop_back();
         }
-        if (parent) {
-            allocator_.dereference(parent);
+        Node* node = allocator_.reference(node_id);
+        while (cur_id != node_id) {
+            stack.push_back(cur_id);
+            Node* cur = allocator_.reference(cur_id);
+            bool is_left;
+            size_t pos = old_pos(cur_id);
+            if (pos < old_stack.size()) {
+                is_left = old_left_mask.test(pos);
+            }
+            else {
+                std::strong_ordering ordering = CompareKey(node->GetKey(), cur->GetKey());
+                if (ordering != 0) {
+                    is_left = ordering < 0;
+                }
+                else {
+                    is_left = leads_to(leads_to, cur->GetLeft(), 2);
+                }
+            }
+            cur_id = is_left ? cur->GetLeft() : cur->GetRight();
+            allocator_.dereference(cur);
         }
-        return node_id;
+        allocator_.dereference(node);
     }
+
     /*
-    * ɾָڵ
+    * ָڵ
     */
-    bool Delete(IteratorStack& stack, NodeAddress del_node_id) {
-        assert(del_node_id != kInvalidAddress);
-        bool is_parent_left;
-        NodeAddress del_min_node_id = Delete(stack, del_node_id, &is_parent_left);
-        if (del_min_node_id == kInvalidAddress) {
-            return false;
-        }
-        if (del_min_node_id != del_node_id) {
-            Node* del_node = allocator_.reference(del_node_id);
-            Node* del_min_node = allocator_.reference(del_min_node_id);
-            /* Ҫɫ */;
-            Color old_color = del_min_node->GetColor();
-            del_min_node->SetColor(del_node->GetColor());
-            del_node->SetColor(old_color);
-            allocator_.dereference(del_min_node);
-            allocator_.dereference(del_node);
-        }
-        DeleteFixup(stack, del_node_id, is_parent_left);
-        return true;
+    template <class K>
+    std::tuple<NodeAddress, std::strong_ordering> Find(IteratorStack& stack, const K& find_key) const {
+        stack.clear();
+        return FindFrom(stack, find_key);
     }
 
     /*
-    * ָڵ
+    * ջڵ㿪ʼ²ңջΪʱӸʼ
+    * ջڵfind_key(NarrowPath)ʱջFindһ
     */
-    std::tuple<NodeAddress, std::strong_ordering> Find(IteratorStack& stack, const Key& find_key) {
+    template <class K>
+    std::tuple<NodeAddress, std::strong_ordering> FindFrom(IteratorStack& stack, const K& find_key) const {
         NodeAddress cur_id = root_;
-        stack.clear();
+        if (!stack.empty()) {
+            cur_id = stack.front(); stack.pop_back();
+        }
         NodeAddress perv_id = kInvalidAddress;
-        std::strong_ordering ordering;
+        std::strong_ordering ordering = std::strong_ordering::equal;
         while (cur_id != kInvalidAddress) {
             perv_id = cur_id;
             Node* cur = allocator_.reference(cur_id);
-            Key& cur_key = cur->GetElement().key;
-            ordering = find_key <=> cur_key;
+            const Key& cur_key = cur->GetKey();
+            ordering = CompareKey(find_key, cur_key);
             if (ordering < 0) {
-            //if (key_compare{}(key, cur_key)) {
-                //ordering = -1;
                 cur_id = cur->GetLeft();
             }
             else if (ordering > 0) {
-            //else if (key_compare{}(cur_key, key)) {
-                //ordering = 1;
                 cur_id = cur->GetRight();
             }
             else {
-                //ordering = 0;
                 allocator_.dereference(cur);
                 return std::tuple{ cur_id, ordering };
             }
@@ -1126,6 +3945,71 @@ private:
         return { perv_id, ordering };
     }
 
+    /*
+    * ҲλãջFindFromһ
+    * ظkeyʱҲ½½ڵȽڵ֮󣬱ֲ˳
+    */
+    template <class K>
+    std::tuple<NodeAddress, std::strong_ordering> FindInsertFrom(IteratorStack& stack, const K& find_key) const {
+        if constexpr (!kMulti) {
+            return FindFrom(stack, find_key);
+        }
+        else {
+            NodeAddress cur_id = root_;
+            if (!stack.empty()) {
+                cur_id = stack.front(); stack.pop_back();
+            }
+            NodeAddress perv_id = kInvalidAddress;
+            std::strong_ordering ordering = std::strong_ordering::greater;
+            while (cur_id != kInvalidAddress) {
+                perv_id = cur_id;
+                Node* cur = allocator_.reference(cur_id);
+                ordering = CompareKey(find_key, cur->GetKey()) < 0 ? std::strong_ordering::less : std::strong_ordering::greater;
+                cur_id = ordering < 0 ? cur->GetLeft() : cur->GetRight();
+                if (cur_id != kInvalidAddress) {
+                    stack.push_back(perv_id);
+                }
+                allocator_.dereference(cur);
+            }
+            return { perv_id, ordering };
+        }
+    }
+
+    /*
+    * ͳСڵм¼ıȽϣһʱkInvalidAddress
+    */
+    size_type CheckCount(NodeAddress node_id) {
+        if (node_id == kInvalidAddress) {
+            return 0;
+        }
+        Node* node = allocator_.reference(node_id);
+        NodeAddress left_id = node->GetLeft(), right_id = node->GetRight();
+        size_type count = node->GetCount();
+        allocator_.dereference(node);
+        size_type left_count = CheckCount(left_id);
+        size_type right_count = CheckCount(right_id);
+        if (left_count == kInvalidAddress || right_count == kInvalidAddress || left_count + right_count + 1 != count) {
+            return kInvalidAddress;
+        }
+        return count;
+    }
+
+    /*
+    * ڵ¼ľۺֵǷɺӼһ
+    */
+    bool CheckAggregate(NodeAddress node_id) {
+        if (node_id == kInvalidAddress) {
+            return true;
+        }
+        Node* node = allocator_.reference(node_id);
+        auto aggregate = node->GetAggregate();
+        UpdateAggregate(node);
+        bool correct = aggregate == node->GetAggregate();
+        NodeAddress left_id = node->GetLeft(), right_id = node->GetRight();
+        allocator_.dereference(node);
+        return correct && CheckAggregate(left_id) && CheckAggregate(right_id);
+    }
+
     /*
     * ·ǷϺ
     */
@@ -1154,9 +4038,27 @@ private:
 
 
 private:
-    AllocatorType allocator_;
+    /*
+    * compactĽȣepochһ˵ڼ䷢޸
+    */
+    struct CompactState {
+        RbTree staging;
+        IteratorStack staging_stack;
+        NodeAddress staging_max_id = kInvalidAddress;
+        NodeAddress node_id = kInvalidAddress;
+        IteratorStack stack;
+        uint64_t epoch = 0;
+    };
+
+    mutable AllocatorType allocator_;
     NodeAddress root_ = kInvalidAddress;
+    /* С/ڵ㣬ɾʱά */
+    NodeAddress leftmost_ = kInvalidAddress;
+    NodeAddress rightmost_ = kInvalidAddress;
     size_type size_ = 0;
+    /* ÿ޸ṹʱ */
+    uint64_t epoch_ = 0;
+    std::unique_ptr<CompactState> compact_;
 };
 
 } // namespace rbt
@@ -1,13 +1,29 @@
 #ifndef RBT_SET_HPP_
 #define RBT_SET_HPP_
 
+#include <concepts>
+#include <type_traits>
+
 #include <rbt/rb_tree.hpp>
+#include <rbt/b_tree.hpp>
 
 namespace rbt {
 
-template <class KeyT, class KeyCompareT>
+template <class KeyT, class KeyCompareT, bool kMultiT = false, template <class> class PoolT = fpoo::CompactMemoryPool, bool kOrderStatisticT = false, class MonoidT = void, class NodeAddressT = uint32_t>
 class SetTraits {
 public:
+    static constexpr bool kMulti = kMultiT;
+    /* 节点额外记录子树大小，提供nth/rank/count_range */
+    static constexpr bool kOrderStatistic = kOrderStatisticT;
+    /* 节点额外记录子树聚合值，提供reduce，void表示不启用 */
+    using Monoid = MonoidT;
+    /* 节点地址宽度，uint16_t/uint32_t/uint64_t */
+    using NodeAddress = NodeAddressT;
+
+    /* 节点所在的内存池，可换为MappedPool以映射到文件 */
+    template <class T>
+    using Pool = PoolT<T>;
+
     using Key = KeyT;
     using Value = Key;
     struct Element {
@@ -22,14 +38,82 @@ public:
 
     using KeyCompare = KeyCompareT;
     using ValueCompare = KeyCompare;
+    using ThreeWayCompare = rbt::ThreeWayCompare<Key, KeyCompare>;
+
+    static const Key& GetKey(const Element& element) {
+        return element.key;
+    }
+
+    static const Key& GetKey(const Value& value) {
+        return value;
+    }
+
+    /*
+    * 无需构造元素即可取得key的emplace参数形式
+    */
+    template <class K>
+        requires std::same_as<std::remove_cvref_t<K>, Key>
+    static const Key& ExtractKey(const K& key) {
+        return key;
+    }
+
+    static Value& GetValue(Element& element) {
+        return element.key;
+    }
 };
 
-template <class Key, class Compare = std::less<Key>>
-class set : public RbTree<SetTraits<Key, Compare>> {
+/*
+* shrink_to_fit/compact在Pool为MappedPool或ArenaPool时不做任何事(compact直接返回true)
+* 映射文件的节点布局即文件内容，arena中的节点与其他树混放，二者都只能整体释放
+*/
+template <class Key, class Compare = std::less<Key>, template <class> class Pool = fpoo::CompactMemoryPool, bool kOrderStatistic = false, class Monoid = void, class NodeAddress = uint32_t>
+class set : public RbTree<SetTraits<Key, Compare, false, Pool, kOrderStatistic, Monoid, NodeAddress>> {
 private:
-    using Tree = RbTree<SetTraits<Key, Compare>>;
+    using Tree = RbTree<SetTraits<Key, Compare, false, Pool, kOrderStatistic, Monoid, NodeAddress>>;
 public:
+    using Tree::Tree;
 
+};
+
+/*
+* 相等的key按插入顺序排列
+*/
+template <class Key, class Compare = std::less<Key>, template <class> class Pool = fpoo::CompactMemoryPool, bool kOrderStatistic = false, class Monoid = void, class NodeAddress = uint32_t>
+class multiset : public RbTree<SetTraits<Key, Compare, true, Pool, kOrderStatistic, Monoid, NodeAddress>> {
+private:
+    using Tree = RbTree<SetTraits<Key, Compare, true, Pool, kOrderStatistic, Monoid, NodeAddress>>;
+public:
+    using typename Tree::value_type;
+    using typename Tree::iterator;
+
+    using Tree::Tree;
+    using Tree::insert;
+
+    /* 总是插入成功，因此只返回迭代器 */
+    iterator insert(const value_type& value) {
+        return Tree::insert(value).first;
+    }
+
+    iterator insert(value_type&& value) {
+        return Tree::insert(std::move(value)).first;
+    }
+
+    template <class... Args>
+    iterator emplace(Args&&... args) {
+        return Tree::emplace(std::forward<Args>(args)...).first;
+    }
+};
+
+/*
+* 以B+树为引擎的set，模板参数与set的前几个一致，替换类型名即可切换
+* 查找与遍历更快、空间更省，但插入或删除会使所有迭代器失效(见BTree)
+*/
+template <class Key, class Compare = std::less<Key>, template <class> class Pool = fpoo::CompactMemoryPool>
+class btree_set : public BTree<SetTraits<Key, Compare, false, Pool>> {
+private:
+    using Tree = BTree<SetTraits<Key, Compare, false, Pool>>;
+public:
+    using Tree::Tree;
 
 };
 
@@ -0,0 +1,144 @@
+#ifndef RBT_SMALL_POOL_HPP_
+#define RBT_SMALL_POOL_HPP_
+
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace rbt {
+
+/*
+* 面向大量小容器的节点池，接口与fpoo::CompactMemoryPool一致
+* 空池不分配内存，第一块只容纳kFirstBlock个节点，之后每块翻倍，直到达到4096字节后保持不变
+* 节点分配后不会移动，reference得到的指针在释放前一直有效
+*/
+template <class T>
+class SmallPool {
+public:
+    static_assert(sizeof(T) >= sizeof(uint32_t));
+
+    static constexpr uint32_t kInvalidAddress = 0x7fffffff;
+
+    using value_type = T;
+    using size_type = uint32_t;
+    using difference_type = int32_t;
+
+    SmallPool() = default;
+
+    SmallPool(const SmallPool&) = delete;
+    SmallPool& operator=(const SmallPool&) = delete;
+
+    SmallPool(SmallPool&& right) noexcept :
+        blocks_(std::move(right.blocks_)), next_(right.next_), capacity_(right.capacity_), free_head_(right.free_head_) {
+        right.blocks_.clear();
+        right.next_ = 0;
+        right.capacity_ = 0;
+        right.free_head_ = kInvalidAddress;
+    }
+
+    SmallPool& operator=(SmallPool&& right) noexcept {
+        if (this != &right) {
+            reset();
+            blocks_ = std::move(right.blocks_);
+            next_ = right.next_;
+            capacity_ = right.capacity_;
+            free_head_ = right.free_head_;
+            right.blocks_.clear();
+            right.next_ = 0;
+            right.capacity_ = 0;
+            right.free_head_ = kInvalidAddress;
+        }
+        return *this;
+    }
+
+    ~SmallPool() {
+        reset();
+    }
+
+    /*
+    * 释放所有块
+    */
+    void reset() noexcept {
+        std::allocator<T> allocator;
+        for (size_t i = 0; i < blocks_.size(); ++i) {
+            allocator.deallocate(blocks_[i], BlockSize(i));
+        }
+        blocks_.clear();
+        blocks_.shrink_to_fit();
+        next_ = 0;
+        capacity_ = 0;
+        free_head_ = kInvalidAddress;
+    }
+
+    uint32_t allocate() {
+        if (free_head_ != kInvalidAddress) {
+            uint32_t addr = free_head_;
+            std::memcpy(&free_head_, Slot(addr), sizeof(uint32_t));
+            return addr;
+        }
+        if (next_ == capacity_) {
+            uint32_t block_size = BlockSize(blocks_.size());
+            if (capacity_ >= kInvalidAddress - block_size) {
+                return kInvalidAddress;
+            }
+            blocks_.push_back(std::allocator<T>{}.allocate(block_size));
+            capacity_ += block_size;
+        }
+        return next_++;
+    }
+
+    void deallocate(uint32_t addr) noexcept {
+        std::memcpy(static_cast<void*>(Slot(addr)), &free_head_, sizeof(uint32_t));
+        free_head_ = addr;
+    }
+
+    T* reference(uint32_t addr) const noexcept {
+        if (addr >= next_) {
+            return nullptr;
+        }
+        return Slot(addr);
+    }
+
+    void dereference(T*) const noexcept {
+    }
+
+private:
+    /* 第一块的节点数，覆盖绝大多数只有几个元素的容器 */
+    static constexpr uint32_t kFirstBlock = 4;
+    /* 翻倍到一块4096字节为止，与fpoo的块大小相当 */
+    static constexpr uint32_t kLastBlock = std::max<uint32_t>(kFirstBlock, std::bit_floor(4096 / sizeof(T)));
+    /* 翻倍阶段的块数，以及这些块容纳的节点总数 */
+    static constexpr uint32_t kGrowBlocks = std::countr_zero(kLastBlock / kFirstBlock);
+    static constexpr uint32_t kGrowCapacity = kLastBlock - kFirstBlock;
+
+    static constexpr uint32_t BlockSize(size_t index) noexcept {
+        return index < kGrowBlocks ? kFirstBlock << index : kLastBlock;
+    }
+
+    /*
+    * 块大小都是2的幂，地址到(块, 偏移)只需移位
+    */
+    T* Slot(uint32_t addr) const noexcept {
+        if (addr < kGrowCapacity) {
+            uint32_t index = std::bit_width(addr / kFirstBlock + 1) - 1;
+            return blocks_[index] + (addr + kFirstBlock - (kFirstBlock << index));
+        }
+        addr -= kGrowCapacity;
+        return blocks_[kGrowBlocks + addr / kLastBlock] + addr % kLastBlock;
+    }
+
+    std::vector<T*> blocks_;
+    uint32_t next_ = 0;             /* 从未分配过的第一个地址 */
+    uint32_t capacity_ = 0;
+    uint32_t free_head_ = kInvalidAddress;     /* 空闲链表，链接存放在空闲节点的前4字节 */
+};
+
+} // namespace rbt
+
+#endif // RBT_SMALL_POOL_HPP_
@@ -3,8 +3,11 @@
 
 #include <iostream>
 #include <chrono>
+#include <algorithm>
+#include <filesystem>
 
 #include <rbt/set.hpp>
+#include <rbt/map.hpp>
 #include <set>
 #include <map>
 
@@ -60,6 +63,37 @@ struct test {
 	constexpr std::strong_ordering operator<=>(const test& rhs) const = default;
 };
 
+/* 64字节的key使B+树的叶子与内部节点都只有4个槽位，少量元素即可反复分裂、借用与合并 */
+struct WideKey {
+	int64_t value = 0;
+	char padding[56] = {};
+
+	WideKey() = default;
+	WideKey(int64_t v) : value(v) {}
+
+	friend std::strong_ordering operator<=>(const WideKey& a, const WideKey& b) {
+		return a.value <=> b.value;
+	}
+
+	friend bool operator==(const WideKey& a, const WideKey& b) {
+		return a.value == b.value;
+	}
+};
+
+/* 公开BTree的VerifyTree，用于检查结构 */
+template <class BTreeT>
+struct CheckedBTree : BTreeT {
+	using BTreeT::BTreeT;
+	using BTreeT::VerifyTree;
+};
+
+/* 公开RbTree的VerifyTree，用于检查结构 */
+template <class TreeT>
+struct CheckedRbTree : TreeT {
+	using TreeT::TreeT;
+	using TreeT::VerifyTree;
+};
+
 
 
 int main()
@@ -132,6 +166,1255 @@ int main()
 	}
 
 
+	{
+		std::cout << "rbt::set::find_batch" << std::endl;
+		std::vector<const Type*> result(data.size());
+		auto start_time = std::chrono::high_resolution_clock::now();
+		rbt_set.find_batch(data.begin(), data.end(), result.begin());
+		for (auto ptr : result) {
+			if (ptr == nullptr) {
+				printf("???");
+			}
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+	}
+
+
+	{
+		std::cout << "std::set::iterate" << std::endl;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		Type sum = 0;
+		for (auto& d : std_set) {
+			sum += d;
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << " sum: " << sum << std::endl;
+	}
+
+
+	{
+		std::cout << "rbt::set::iterate" << std::endl;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		Type sum = 0;
+		for (auto& d : rbt_set) {
+			sum += d;
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << " sum: " << sum << std::endl;
+	}
+
+
+	{
+		std::cout << "rbt::set::assign_sorted" << std::endl;
+		auto sorted = data;
+		std::sort(sorted.begin(), sorted.end());
+		auto start_time = std::chrono::high_resolution_clock::now();
+		rbt::set<Type> bulk_set;
+		bulk_set.assign_sorted(sorted.begin(), sorted.end());
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+
+		std::cout << "rbt::set::insert_sorted" << std::endl;
+		start_time = std::chrono::high_resolution_clock::now();
+		rbt::set<Type> sorted_set;
+		sorted_set.insert_sorted(sorted.begin(), sorted.end());
+		end_time = std::chrono::high_resolution_clock::now();
+		duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+
+		std::cout << "rbt::set::find(assign_sorted)" << std::endl;
+		start_time = std::chrono::high_resolution_clock::now();
+		for (auto& d : data) {
+			auto iter = bulk_set.find(d);
+			if (iter == bulk_set.end()) {
+				printf("???");
+			}
+		}
+		end_time = std::chrono::high_resolution_clock::now();
+		duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+
+		std::cout << "rbt::set::clear" << std::endl;
+		start_time = std::chrono::high_resolution_clock::now();
+		bulk_set.clear();
+		sorted_set.clear();
+		end_time = std::chrono::high_resolution_clock::now();
+		auto duration_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+		std::cout << "time: " << duration_us.count() << "us" << std::endl;
+	}
+
+
+	{
+		std::cout << "std::set::erase" << std::endl;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < data.size(); i += 2) {
+			if (std_set.erase(data[i]) != 1) {
+				printf("???");
+			}
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+	}
+
+	{
+		std::cout << "rbt::set::erase" << std::endl;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < data.size(); i += 2) {
+			if (rbt_set.erase(data[i]) != 1) {
+				printf("???");
+			}
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+	}
+
+	{
+		std::cout << "std::set::erase(first, last)" << std::endl;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		std_set.erase(std_set.begin(), std::next(std_set.begin(), std_set.size() / 2));
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+	}
+
+	{
+		std::cout << "rbt::set::erase(first, last)" << std::endl;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		rbt_set.erase(rbt_set.begin(), std::next(rbt_set.begin(), rbt_set.size() / 2));
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+		if (!std::equal(rbt_set.begin(), rbt_set.end(), std_set.begin(), std_set.end())) {
+			printf("???");
+		}
+	}
+
+	{
+		std::cout << "std::set::next(k)" << std::endl;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		Type sum = 0;
+		for (size_t i = 0; i < 100; i++) {
+			sum += *std::next(std_set.begin(), (i * 7919) % std_set.size());
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << " sum: " << sum << std::endl;
+
+		rbt::set<Type, std::less<Type>, fpoo::CompactMemoryPool, true> os_set(std_set.begin(), std_set.end());
+		std::cout << "rbt::set::nth(k)" << std::endl;
+		start_time = std::chrono::high_resolution_clock::now();
+		sum = 0;
+		for (size_t i = 0; i < 100; i++) {
+			sum += *os_set.nth(static_cast<uint32_t>((i * 7919) % os_set.size()));
+		}
+		end_time = std::chrono::high_resolution_clock::now();
+		auto duration_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+		std::cout << "time: " << duration_us.count() << "us" << " sum: " << sum << std::endl;
+	}
+
+	{
+		std::cout << "std::set::window_sum" << std::endl;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		Type sum = 0;
+		for (size_t i = 0; i < 1000; i++) {
+			Type lo = data[i], hi = lo + count / 10;
+			for (auto it = std_set.lower_bound(lo); it != std_set.end() && *it < hi; ++it) {
+				sum += *it;
+			}
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << " sum: " << sum << std::endl;
+
+		rbt::set<Type, std::less<Type>, fpoo::CompactMemoryPool, false, rbt::SumMonoid<Type>> sum_set(std_set.begin(), std_set.end());
+		std::cout << "rbt::set::reduce" << std::endl;
+		start_time = std::chrono::high_resolution_clock::now();
+		sum = 0;
+		for (size_t i = 0; i < 1000; i++) {
+			Type lo = data[i], hi = lo + count / 10;
+			sum += sum_set.reduce(lo, hi);
+		}
+		end_time = std::chrono::high_resolution_clock::now();
+		auto duration_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+		std::cout << "time: " << duration_us.count() << "us" << " sum: " << sum << std::endl;
+	}
+
+	{
+		rbt::set<Type, std::less<Type>, fpoo::CompactMemoryPool, true> os_set(std_set.begin(), std_set.end());
+		rbt::set<Type, std::less<Type>, fpoo::CompactMemoryPool, true> right;
+		Type boundary = *os_set.nth(os_set.size() * 9 / 10);
+		std::cout << "rbt::set::split" << std::endl;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		os_set.split(boundary, right);
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "us" << std::endl;
+
+		std::cout << "rbt::set::join" << std::endl;
+		start_time = std::chrono::high_resolution_clock::now();
+		os_set.join(std::move(right));
+		end_time = std::chrono::high_resolution_clock::now();
+		duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "us" << std::endl;
+		if (!std::equal(os_set.begin(), os_set.end(), std_set.begin(), std_set.end())) {
+			printf("???");
+		}
+	}
+
+	{
+		std::set<Type> std_other;
+		for (size_t i = 1; i < data.size(); i += 3) {
+			std_other.insert(data[i]);
+		}
+		std::cout << "std::set_intersection" << std::endl;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		std::set<Type> std_result;
+		std::set_intersection(std_set.begin(), std_set.end(), std_other.begin(), std_other.end(), std::inserter(std_result, std_result.end()));
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+
+		rbt::set<Type> rbt_other(std_other.begin(), std_other.end());
+		rbt::set<Type> rbt_result = rbt_set;
+		std::cout << "rbt::set::set_intersection" << std::endl;
+		start_time = std::chrono::high_resolution_clock::now();
+		rbt_result.set_intersection(rbt_other);
+		end_time = std::chrono::high_resolution_clock::now();
+		duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+		if (!std::equal(rbt_result.begin(), rbt_result.end(), std_result.begin(), std_result.end())) {
+			printf("???");
+		}
+	}
+
+
+	{
+		std::cout << "rbt::set<uint32_t address>::find(small)" << std::endl;
+		std::vector<rbt::set<Type>> sets32(1000);
+		std::vector<rbt::set<Type, std::less<Type>, fpoo::CompactMemoryPool, false, void, uint16_t>> sets16(1000);
+		for (size_t i = 0; i < data.size(); i++) {
+			sets32[i % sets32.size()].insert(data[i]);
+			sets16[i % sets16.size()].insert(data[i]);
+		}
+		auto start_time = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < data.size(); i++) {
+			auto& s = sets32[i % sets32.size()];
+			if (s.find(data[i]) == s.end()) {
+				printf("???");
+			}
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+
+		std::cout << "rbt::set<uint16_t address>::find(small)" << std::endl;
+		start_time = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < data.size(); i++) {
+			auto& s = sets16[i % sets16.size()];
+			if (s.find(data[i]) == s.end()) {
+				printf("???");
+			}
+		}
+		end_time = std::chrono::high_resolution_clock::now();
+		duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+	}
+
+
+	{
+		std::cout << "rbt::set<CompactMemoryPool>::insert(small)" << std::endl;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		std::vector<rbt::set<Type>> sets(count / 4);
+		for (size_t i = 0; i < data.size(); i++) {
+			sets[i % sets.size()].insert(data[i]);
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+
+		std::cout << "rbt::set<SmallPool>::insert(small)" << std::endl;
+		start_time = std::chrono::high_resolution_clock::now();
+		std::vector<rbt::set<Type, std::less<Type>, rbt::SmallPool>> small_sets(count / 4);
+		for (size_t i = 0; i < data.size(); i++) {
+			small_sets[i % small_sets.size()].insert(data[i]);
+		}
+		end_time = std::chrono::high_resolution_clock::now();
+		duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+
+		for (size_t i = 0; i < data.size(); i++) {
+			auto& s = small_sets[i % small_sets.size()];
+			if (s.find(data[i]) == s.end()) {
+				printf("???");
+			}
+		}
+	}
+
+
+	{
+		std::cout << "rbt::set<ArenaPool>::insert(short-lived)" << std::endl;
+		using ArenaSet = rbt::set<Type, std::less<Type>, rbt::ArenaPool>;
+		ArenaSet::arena_type arena;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		for (size_t round = 0; round < 100; round++) {
+			std::vector<ArenaSet> sets;
+			sets.reserve(100);
+			for (size_t i = 0; i < 100; i++) {
+				sets.emplace_back(arena);
+			}
+			for (size_t i = 0; i < data.size() / 100; i++) {
+				sets[i % sets.size()].insert(data[round * (data.size() / 100) + i]);
+			}
+			arena.reset();
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+	}
+
+
+	{
+		/* arena重置后继续插入，失效的树应从空开始，不能与同一arena上的新树共用节点 */
+		using ArenaSet = rbt::set<Type, std::less<Type>, rbt::ArenaPool>;
+		ArenaSet::arena_type arena;
+		ArenaSet stale_set(arena);
+		for (Type i = 0; i < 100; i++) {
+			stale_set.insert(i);
+		}
+		arena.reset();
+		ArenaSet fresh_set(arena);
+		for (Type i = 0; i < 100; i++) {
+			fresh_set.insert(i + 1000);
+		}
+		stale_set.insert(5000);
+		if (stale_set.size() != 1 || *stale_set.begin() != 5000 || fresh_set.size() != 100 ||
+			std::distance(fresh_set.begin(), fresh_set.end()) != 100) {
+			printf("???");
+		}
+	}
+
+
+	{
+		std::cout << "rbt::set::cursor" << std::endl;
+		rbt::set<Type> cursor_set(data.begin(), data.end());
+		auto start_time = std::chrono::high_resolution_clock::now();
+		std::vector<rbt::set<Type>::cursor> cursors;
+		cursors.reserve(data.size());
+		for (auto& d : data) {
+			cursors.push_back(cursor_set.find(d));
+		}
+		for (size_t i = 0; i < data.size(); i++) {
+			if (*cursors[i] != data[i]) {
+				printf("???");
+			}
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+	}
+
+
+	{
+		std::cout << "rbt::set::revalidate(scan-and-erase)" << std::endl;
+		rbt::set<Type> scan_set(data.begin(), data.end());
+		auto start_time = std::chrono::high_resolution_clock::now();
+		for (auto iter = scan_set.begin(); iter != scan_set.end(); ++iter) {
+			if (scan_set.erase(*iter + 1) != 1 && *iter + 1 < count) {
+				printf("???");
+			}
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+		if (scan_set.size() != static_cast<decltype(scan_set.size())>((count + 1) / 2)) {
+			printf("???");
+		}
+	}
+
+
+	{
+		std::cout << "rbt::set::pop_min" << std::endl;
+		rbt::set<Type> queue_set(data.begin(), data.end());
+		auto start_time = std::chrono::high_resolution_clock::now();
+		for (Type expect = 0; !queue_set.empty(); expect++) {
+			if (*queue_set.begin() != expect || queue_set.pop_min() != expect) {
+				printf("???");
+			}
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+	}
+
+
+	{
+		rbt::set<Type> frozen_set(data.begin(), data.end());
+		auto frozen = frozen_set.freeze();
+		std::cout << "rbt::set::frozen_index::find" << std::endl;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		for (auto& d : data) {
+			auto iter = frozen.find(d);
+			if (iter == frozen.end() || *iter != d) {
+				printf("???");
+			}
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+	}
+
+
+	{
+		rbt::btree_set<Type> btree_set;
+		std::cout << "rbt::btree_set::insert" << std::endl;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		for (auto& d : data) {
+			btree_set.insert(d);
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+
+		std::cout << "rbt::btree_set::find" << std::endl;
+		start_time = std::chrono::high_resolution_clock::now();
+		for (auto& d : data) {
+			auto iter = btree_set.find(d);
+			if (iter == btree_set.end() || *iter != d) {
+				printf("???");
+			}
+		}
+		end_time = std::chrono::high_resolution_clock::now();
+		duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+
+		std::cout << "rbt::btree_set::erase" << std::endl;
+		start_time = std::chrono::high_resolution_clock::now();
+		for (auto& d : data) {
+			if (btree_set.erase(d) != 1) {
+				printf("???");
+			}
+		}
+		end_time = std::chrono::high_resolution_clock::now();
+		duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+		if (!btree_set.empty()) {
+			printf("???");
+		}
+	}
+
+
+	{
+		/* 以本树中的元素插入，跨过MappedPool的扩容边界(1024、2048、4096个节点)时节点数组会整体移动 */
+		std::cout << "rbt::multiset<MappedPool>::insert(*begin())" << std::endl;
+		rbt::multiset<int64_t, std::less<int64_t>, rbt::MappedPool> mapped_multiset;
+		mapped_multiset.insert(7);
+		for (int i = 1; i < 5000; i++) {
+			mapped_multiset.insert(*mapped_multiset.begin());
+			mapped_multiset.insert(*--mapped_multiset.end());
+		}
+		if (mapped_multiset.size() != 9999 || mapped_multiset.count(7) != 9999) {
+			printf("???");
+		}
+	}
+
+
+	{
+		std::cout << "rbt::btree_set<WideKey>::insert/erase(verify)" << std::endl;
+		using WideSet = CheckedBTree<rbt::btree_set<WideKey>>;
+		WideSet wide_set;
+		std::set<WideKey> expect_set;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < 200000; i++) {
+			WideKey key{ RandInt() % 5000 };
+			int op = RandInt() % 4;
+			if (op < 2) {
+				if (wide_set.insert(key).second != expect_set.insert(key).second) {
+					printf("???");
+				}
+			}
+			else if (op == 2) {
+				if (wide_set.erase(key) != expect_set.erase(key)) {
+					printf("???");
+				}
+			}
+			else {
+				/* erase(iterator)返回删除后的后继，借用与合并之后也要指向正确的位置 */
+				auto iter = wide_set.lower_bound(key);
+				auto expect_iter = expect_set.lower_bound(key);
+				if ((iter == wide_set.end()) != (expect_iter == expect_set.end())) {
+					printf("???");
+				}
+				else if (iter != wide_set.end()) {
+					iter = wide_set.erase(iter);
+					expect_iter = expect_set.erase(expect_iter);
+					if ((iter == wide_set.end()) != (expect_iter == expect_set.end()) ||
+						(iter != wide_set.end() && *iter != *expect_iter)) {
+						printf("???");
+					}
+				}
+			}
+			if (i % 1000 == 0 && !wide_set.VerifyTree()) {
+				printf("???");
+			}
+		}
+		if (!wide_set.VerifyTree() || wide_set.size() != expect_set.size() ||
+			!std::equal(wide_set.begin(), wide_set.end(), expect_set.begin(), expect_set.end()) ||
+			!std::equal(wide_set.rbegin(), wide_set.rend(), expect_set.rbegin(), expect_set.rend())) {
+			printf("???");
+		}
+		for (Type k = -1; k <= 5001; k++) {
+			auto lower = wide_set.lower_bound(k);
+			auto upper = wide_set.upper_bound(k);
+			auto expect_lower = expect_set.lower_bound(k);
+			auto expect_upper = expect_set.upper_bound(k);
+			if ((lower == wide_set.end() ? expect_lower != expect_set.end() : *lower != *expect_lower) ||
+				(upper == wide_set.end() ? expect_upper != expect_set.end() : *upper != *expect_upper)) {
+				printf("???");
+			}
+		}
+
+		/* 拷贝与范围构造走自底向上的批量构建 */
+		WideSet copy_set(wide_set);
+		WideSet range_set(expect_set.begin(), expect_set.end());
+		if (!copy_set.VerifyTree() || !range_set.VerifyTree() ||
+			!std::equal(copy_set.begin(), copy_set.end(), expect_set.begin(), expect_set.end()) ||
+			!std::equal(range_set.begin(), range_set.end(), expect_set.begin(), expect_set.end())) {
+			printf("???");
+		}
+
+		/* 删除中间一半的区间 */
+		auto first = std::next(copy_set.begin(), copy_set.size() / 4);
+		auto last = std::next(copy_set.begin(), copy_set.size() * 3 / 4);
+		auto next = copy_set.erase(first, last);
+		auto expect_next = expect_set.erase(std::next(expect_set.begin(), expect_set.size() / 4), std::next(expect_set.begin(), expect_set.size() * 3 / 4));
+		if (!copy_set.VerifyTree() || *next != *expect_next ||
+			!std::equal(copy_set.begin(), copy_set.end(), expect_set.begin(), expect_set.end())) {
+			printf("???");
+		}
+
+		/* 从最小值逐个删除到空，途经每一层的合并与降高 */
+		for (size_t i = 0; !range_set.empty(); i++) {
+			range_set.erase(range_set.begin());
+			if (i % 100 == 0 && !range_set.VerifyTree()) {
+				printf("???");
+			}
+		}
+		if (!range_set.VerifyTree() || range_set.begin() != range_set.end()) {
+			printf("???");
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+	}
+
+
+	{
+		std::cout << "rbt::btree_map::operator[]/try_emplace/insert_or_assign(verify)" << std::endl;
+		CheckedBTree<rbt::btree_map<Type, std::string>> btree_map;
+		std::map<Type, std::string> expect_map;
+		for (size_t i = 0; i < 100000; i++) {
+			Type key = RandInt() % 3000;
+			int op = RandInt() % 4;
+			if (op == 0) {
+				btree_map[key] = std::to_string(i);
+				expect_map[key] = std::to_string(i);
+			}
+			else if (op == 1) {
+				if (btree_map.try_emplace(key, "t").second != expect_map.try_emplace(key, "t").second) {
+					printf("???");
+				}
+			}
+			else if (op == 2) {
+				if (btree_map.insert_or_assign(key, std::to_string(key)).second != expect_map.insert_or_assign(key, std::to_string(key)).second) {
+					printf("???");
+				}
+			}
+			else if (btree_map.erase(key) != expect_map.erase(key)) {
+				printf("???");
+			}
+		}
+		if (!btree_map.VerifyTree() || !std::equal(btree_map.begin(), btree_map.end(), expect_map.begin(), expect_map.end())) {
+			printf("???");
+		}
+	}
+
+
+	{
+		/* 与std::map/std::multimap/std::multiset对照，multimap的value记录插入序号，用于检查相等key的插入顺序 */
+		std::cout << "rbt::map/multimap/multiset::emplace/erase(verify)" << std::endl;
+		CheckedRbTree<rbt::map<Type, std::string>> rbt_map;
+		std::map<Type, std::string> expect_map;
+		CheckedRbTree<rbt::multimap<Type, size_t>> rbt_multimap;
+		std::multimap<Type, size_t> expect_multimap;
+		CheckedRbTree<rbt::multiset<Type>> rbt_multiset;
+		std::multiset<Type> expect_multiset;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < 200000; i++) {
+			Type key = RandInt() % 2000;
+			int op = RandInt() % 6;
+			if (op == 0) {
+				auto [iter, inserted] = rbt_map.emplace(key, std::to_string(i));
+				auto [expect_iter, expect_inserted] = expect_map.emplace(key, std::to_string(i));
+				if (inserted != expect_inserted || *iter != *expect_iter) {
+					printf("???");
+				}
+				rbt_multimap.emplace(key, i);
+				expect_multimap.emplace(key, i);
+				rbt_multiset.insert(key);
+				expect_multiset.insert(key);
+			}
+			else if (op == 1) {
+				auto [iter, inserted] = rbt_map.try_emplace(key, "t");
+				auto [expect_iter, expect_inserted] = expect_map.try_emplace(key, "t");
+				if (inserted != expect_inserted || *iter != *expect_iter) {
+					printf("???");
+				}
+				rbt_multimap.insert(std::pair<const Type, size_t>{ key, i });
+				expect_multimap.insert(std::pair<const Type, size_t>{ key, i });
+			}
+			else if (op == 2) {
+				auto [iter, inserted] = rbt_map.insert_or_assign(key, std::to_string(key));
+				auto [expect_iter, expect_inserted] = expect_map.insert_or_assign(key, std::to_string(key));
+				if (inserted != expect_inserted || *iter != *expect_iter) {
+					printf("???");
+				}
+			}
+			else if (op == 3) {
+				if (rbt_map.erase(key) != expect_map.erase(key) ||
+					rbt_multiset.erase(key) != expect_multiset.erase(key)) {
+					printf("???");
+				}
+			}
+			else if (op == 4) {
+				/* 删除相等key中间的一个，返回的后继依赖删除后补齐路径 */
+				auto [first, last] = rbt_multimap.equal_range(key);
+				auto [expect_first, expect_last] = expect_multimap.equal_range(key);
+				if (!std::equal(first, last, expect_first, expect_last)) {
+					printf("???");
+				}
+				size_t n = std::distance(expect_first, expect_last);
+				if (n > 0) {
+					auto offset = RandInt() % n;
+					auto next = rbt_multimap.erase(std::next(first, offset));
+					auto expect_next = expect_multimap.erase(std::next(expect_first, offset));
+					if ((next == rbt_multimap.end()) != (expect_next == expect_multimap.end()) ||
+						(next != rbt_multimap.end() && *next != *expect_next)) {
+						printf("???");
+					}
+				}
+			}
+			else {
+				/* erase(iterator)随机落在树的各处，覆盖删除后后继路径的各种形状 */
+				auto iter = rbt_map.lower_bound(key);
+				auto expect_iter = expect_map.lower_bound(key);
+				if (iter != rbt_map.end()) {
+					iter = rbt_map.erase(iter);
+					expect_iter = expect_map.erase(expect_iter);
+					if ((iter == rbt_map.end()) != (expect_iter == expect_map.end()) ||
+						(iter != rbt_map.end() && *iter != *expect_iter)) {
+						printf("???");
+					}
+				}
+				auto [first, last] = rbt_multiset.equal_range(key);
+				auto [expect_first, expect_last] = expect_multiset.equal_range(key);
+				if (!std::equal(first, last, expect_first, expect_last)) {
+					printf("???");
+				}
+				if (first != last) {
+					rbt_multiset.erase(first);
+					expect_multiset.erase(expect_first);
+				}
+			}
+			if (i % 1000 == 0 && (!rbt_map.VerifyTree() || !rbt_multimap.VerifyTree() || !rbt_multiset.VerifyTree())) {
+				printf("???");
+			}
+		}
+		if (!rbt_map.VerifyTree() || !rbt_multimap.VerifyTree() || !rbt_multiset.VerifyTree() ||
+			!std::equal(rbt_map.begin(), rbt_map.end(), expect_map.begin(), expect_map.end()) ||
+			!std::equal(rbt_multimap.begin(), rbt_multimap.end(), expect_multimap.begin(), expect_multimap.end()) ||
+			!std::equal(rbt_multiset.begin(), rbt_multiset.end(), expect_multiset.begin(), expect_multiset.end()) ||
+			rbt_map.size() != expect_map.size() || rbt_multimap.size() != expect_multimap.size()) {
+			printf("???");
+		}
+		for (Type k = 0; k < 2000; k++) {
+			if (rbt_multimap.count(k) != expect_multimap.count(k) || rbt_multiset.count(k) != expect_multiset.count(k)) {
+				printf("???");
+			}
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+	}
+
+
+	{
+		/* 删除大部分元素后整理，内容不变且仍是合法的红黑树 */
+		std::cout << "rbt::set::shrink_to_fit/compact" << std::endl;
+		CheckedRbTree<rbt::set<Type, std::less<Type>, fpoo::CompactMemoryPool, true, rbt::SumMonoid<Type>>> shrink_set(data.begin(), data.end());
+		std::set<Type> expect_set(data.begin(), data.end());
+		for (auto& d : data) {
+			if (d % 10 != 0) {
+				shrink_set.erase(d);
+				expect_set.erase(d);
+			}
+		}
+		auto compact_set = shrink_set;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		shrink_set.shrink_to_fit();
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+		if (!shrink_set.VerifyTree() || shrink_set.size() != expect_set.size() ||
+			!std::equal(shrink_set.begin(), shrink_set.end(), expect_set.begin(), expect_set.end())) {
+			printf("???");
+		}
+
+		/* 增量整理中途修改，整理作废后重新开始，最终包含修改后的内容 */
+		size_t steps = 0;
+		while (!compact_set.compact(1000)) {
+			if (++steps == 10) {
+				compact_set.insert(-1);
+				expect_set.insert(-1);
+			}
+		}
+		if (!compact_set.VerifyTree() || compact_set.size() != expect_set.size() ||
+			!std::equal(compact_set.begin(), compact_set.end(), expect_set.begin(), expect_set.end()) ||
+			*compact_set.nth(0) != -1) {
+			printf("???");
+		}
+		compact_set.insert(count);
+		expect_set.insert(count);
+		if (!compact_set.VerifyTree() || !std::equal(compact_set.begin(), compact_set.end(), expect_set.begin(), expect_set.end())) {
+			printf("???");
+		}
+
+		/* 共享arena的树不迁移，整理直接完成且内容不变 */
+		using ArenaSet = rbt::set<Type, std::less<Type>, rbt::ArenaPool>;
+		ArenaSet::arena_type arena;
+		ArenaSet arena_set(arena);
+		for (Type i = 0; i < 1000; i++) {
+			arena_set.insert(i);
+		}
+		arena_set.shrink_to_fit();
+		if (!arena_set.compact(1) || arena_set.size() != 1000 || *arena_set.begin() != 0 || *arena_set.rbegin() != 999) {
+			printf("???");
+		}
+	}
+
+
+	{
+		/* lower_bound/upper_bound与std::set对照，返回的迭代器带有路径，继续++/--也要正确 */
+		auto same = [](auto iter, auto end, auto expect_iter, auto expect_end) {
+			return iter == end ? expect_iter == expect_end : expect_iter != expect_end && *iter == *expect_iter;
+		};
+		std::set<Type> expect_set;
+		std::multiset<Type> expect_multiset;
+		for (size_t i = 0; i < 20000; i++) {
+			expect_set.insert(data[i] * 2);
+			expect_multiset.insert(data[i] % 5000 * 2);
+		}
+		rbt::set<Type> bound_set(expect_set.begin(), expect_set.end());
+		rbt::multiset<Type> bound_multiset;
+		for (size_t i = 0; i < 20000; i++) {
+			bound_multiset.insert(data[i] % 5000 * 2);
+		}
+		const auto& const_set = bound_set;
+		auto frozen = bound_set.freeze();
+		auto frozen_multi = bound_multiset.freeze();
+		for (Type k = -1; k <= count * 2 + 1; k += (k < 12000 ? 1 : 997)) {
+			auto expect_lower = expect_set.lower_bound(k);
+			auto expect_upper = expect_set.upper_bound(k);
+			auto lower = bound_set.lower_bound(k);
+			auto upper = const_set.upper_bound(k);
+			auto [first, last] = bound_set.equal_range(k);
+			if (!same(lower, bound_set.end(), expect_lower, expect_set.end()) ||
+				!same(upper, const_set.end(), expect_upper, expect_set.end()) ||
+				first != lower || last != upper ||
+				!same(frozen.lower_bound(k), frozen.end(), expect_lower, expect_set.end()) ||
+				!same(frozen.upper_bound(k), frozen.end(), expect_upper, expect_set.end())) {
+				printf("???");
+			}
+			if (lower != bound_set.end() && (!same(std::next(lower), bound_set.end(), std::next(expect_lower), expect_set.end()) ||
+				(lower != bound_set.begin() && *std::prev(lower) != *std::prev(expect_lower)))) {
+				printf("???");
+			}
+			if (k < 12000) {
+				auto [multi_first, multi_last] = bound_multiset.equal_range(k);
+				auto [expect_first, expect_last] = expect_multiset.equal_range(k);
+				if (!same(multi_first, bound_multiset.end(), expect_first, expect_multiset.end()) ||
+					!same(multi_last, bound_multiset.end(), expect_last, expect_multiset.end()) ||
+					!same(bound_multiset.upper_bound(k), bound_multiset.end(), expect_last, expect_multiset.end()) ||
+					std::distance(frozen_multi.lower_bound(k), frozen_multi.upper_bound(k)) != std::distance(expect_first, expect_last) ||
+					!same(frozen_multi.upper_bound(k), frozen_multi.end(), expect_last, expect_multiset.end())) {
+					printf("???");
+				}
+			}
+		}
+
+		/* 透明比较器，以string_view查找，不构造std::string */
+		std::set<std::string, std::less<>> expect_str_set;
+		for (size_t i = 0; i < 5000; i++) {
+			expect_str_set.insert(std::to_string(data[i]));
+		}
+		rbt::set<std::string, std::less<>> str_set(expect_str_set.begin(), expect_str_set.end());
+		auto frozen_str = str_set.freeze();
+		for (size_t i = 0; i < 10000; i++) {
+			std::string probe = std::to_string(RandInt() % count);
+			probe.resize(probe.size() - (i % 3 == 0 && probe.size() > 1));
+			std::string_view view = probe;
+			if (!same(str_set.lower_bound(view), str_set.end(), expect_str_set.lower_bound(view), expect_str_set.end()) ||
+				!same(str_set.upper_bound(view), str_set.end(), expect_str_set.upper_bound(view), expect_str_set.end()) ||
+				!same(frozen_str.lower_bound(view), frozen_str.end(), expect_str_set.lower_bound(view), expect_str_set.end()) ||
+				!same(frozen_str.upper_bound(view), frozen_str.end(), expect_str_set.upper_bound(view), expect_str_set.end()) ||
+				str_set.contains(view) != expect_str_set.contains(view)) {
+				printf("???");
+			}
+		}
+	}
+
+
+	{
+		/* save之后直接映射回来查找，只读映射上的修改抛出异常，读写映射的修改在重新打开后仍然存在 */
+		std::cout << "rbt::set<MappedPool>::save/open_mmap" << std::endl;
+		using MappedSet = CheckedRbTree<rbt::set<Type, std::less<Type>, rbt::MappedPool>>;
+		std::string path = (std::filesystem::temp_directory_path() / "rbt_test_pool.bin").string();
+		std::set<Type> expect_set(data.begin(), data.begin() + data.size() / 10);
+		rbt::set<Type> source_set(expect_set.begin(), expect_set.end());
+		source_set.save(path);
+		auto check = [&](MappedSet& mapped_set) {
+			if (!mapped_set.VerifyTree() || mapped_set.size() != expect_set.size() ||
+				!std::equal(mapped_set.begin(), mapped_set.end(), expect_set.begin(), expect_set.end())) {
+				printf("???");
+			}
+			for (size_t i = 0; i < data.size(); i += 7) {
+				if (mapped_set.contains(data[i]) != expect_set.contains(data[i])) {
+					printf("???");
+				}
+			}
+		};
+		{
+			MappedSet mapped_set;
+			mapped_set.open_mmap(path);
+			check(mapped_set);
+			size_t thrown = 0;
+			try { mapped_set.insert(-1); } catch (const std::logic_error&) { thrown++; }
+			try { mapped_set.erase(*expect_set.begin()); } catch (const std::logic_error&) { thrown++; }
+			try { mapped_set.erase(mapped_set.begin()); } catch (const std::logic_error&) { thrown++; }
+			if (thrown != 3) {
+				printf("???");
+			}
+			check(mapped_set);
+		}
+		{
+			MappedSet mapped_set;
+			mapped_set.open_mmap(path, rbt::MapMode::kReadWrite);
+			check(mapped_set);
+			for (size_t i = 0; i < data.size() / 5; i++) {
+				if (data[i] % 2 == 0) {
+					mapped_set.erase(data[i]);
+					expect_set.erase(data[i]);
+				}
+				else {
+					mapped_set.insert(-data[i]);
+					expect_set.insert(-data[i]);
+				}
+			}
+			check(mapped_set);
+		}
+		{
+			MappedSet mapped_set;
+			mapped_set.open_mmap(path);
+			check(mapped_set);
+		}
+
+		/* 文件头的根越过已分配的节点时拒绝打开 */
+		{
+			std::FILE* file = std::fopen(path.c_str(), "r+b");
+			rbt::MappedPoolHeader header;
+			std::fread(&header, sizeof(header), 1, file);
+			header.root = header.next;
+			std::fseek(file, 0, SEEK_SET);
+			std::fwrite(&header, sizeof(header), 1, file);
+			std::fclose(file);
+			MappedSet mapped_set;
+			bool thrown = false;
+			try { mapped_set.open_mmap(path); } catch (const std::runtime_error&) { thrown = true; }
+			if (!thrown || !mapped_set.empty()) {
+				printf("???");
+			}
+		}
+		std::filesystem::remove(path);
+	}
+
+
+	{
+		/* nth/rank/count_range/reduce与有序数组对照，包括删除、拆分与拼接之后 */
+		std::cout << "rbt::set::nth/rank/reduce(verify)" << std::endl;
+		using OsSet = CheckedRbTree<rbt::set<Type, std::less<Type>, fpoo::CompactMemoryPool, true, rbt::SumMonoid<Type>>>;
+		using MinSet = CheckedRbTree<rbt::set<Type, std::less<Type>, fpoo::CompactMemoryPool, false, rbt::MinMonoid<Type>>>;
+		using MaxSet = CheckedRbTree<rbt::set<Type, std::less<Type>, fpoo::CompactMemoryPool, true, rbt::MaxMonoid<Type>>>;
+		auto check_order = [&](OsSet& os_set, const std::set<Type>& expect) {
+			std::vector<Type> sorted(expect.begin(), expect.end());
+			std::vector<Type> prefix(sorted.size() + 1);
+			for (size_t i = 0; i < sorted.size(); i++) {
+				prefix[i + 1] = prefix[i] + sorted[i];
+			}
+			if (!os_set.VerifyTree() || os_set.size() != sorted.size() || os_set.nth(os_set.size()) != os_set.end() ||
+				os_set.reduce() != prefix.back()) {
+				printf("???");
+			}
+			for (size_t i = 0; i < sorted.size(); i++) {
+				auto iter = os_set.nth(i);
+				if (*iter != sorted[i] || os_set.rank(sorted[i]) != i || os_set.rank(*iter) != i) {
+					printf("???");
+				}
+				if (i % 97 == 0 && ++iter != os_set.end() && *iter != sorted[i + 1]) {
+					printf("???");
+				}
+			}
+			for (size_t i = 0; i < 2000; i++) {
+				Type lo = data[i * 7919 % data.size()] - 1;
+				Type hi = lo + static_cast<Type>(i % 100) * count / 5000;
+				size_t lo_rank = std::lower_bound(sorted.begin(), sorted.end(), lo) - sorted.begin();
+				size_t hi_rank = std::lower_bound(sorted.begin(), sorted.end(), hi) - sorted.begin();
+				if (os_set.rank(lo) != lo_rank || os_set.count_range(lo, hi) != hi_rank - lo_rank ||
+					os_set.reduce(lo, hi) != prefix[hi_rank] - prefix[lo_rank] || os_set.count_range(hi, lo) != 0) {
+					printf("???");
+				}
+			}
+		};
+		auto check_extreme = [&](auto& extreme_set, const std::set<Type>& expect, auto pick, Type identity) {
+			if (!extreme_set.VerifyTree() || !std::equal(extreme_set.begin(), extreme_set.end(), expect.begin(), expect.end())) {
+				printf("???");
+			}
+			for (size_t i = 0; i < 2000; i++) {
+				Type lo = data[i * 7919 % data.size()] - 1;
+				Type hi = lo + static_cast<Type>(i % 100) * count / 5000;
+				Type brute = identity;
+				for (auto iter = expect.lower_bound(lo); iter != expect.end() && *iter < hi; ++iter) {
+					brute = pick(brute, *iter);
+				}
+				if (extreme_set.reduce(lo, hi) != brute) {
+					printf("???");
+				}
+			}
+		};
+		auto min_of = [](Type a, Type b) { return std::min(a, b); };
+		auto max_of = [](Type a, Type b) { return std::max(a, b); };
+		Type min_identity = std::numeric_limits<Type>::max();
+		Type max_identity = std::numeric_limits<Type>::lowest();
+
+		OsSet os_set;
+		MinSet min_set;
+		MaxSet max_set;
+		std::set<Type> expect_set;
+		for (size_t i = 0; i < 20000; i++) {
+			os_set.insert(data[i]);
+			min_set.insert(data[i]);
+			max_set.insert(data[i]);
+			expect_set.insert(data[i]);
+		}
+		for (size_t i = 0; i < 20000; i += 3) {
+			os_set.erase(data[i]);
+			min_set.erase(min_set.find(data[i]));
+			max_set.erase(data[i]);
+			expect_set.erase(data[i]);
+		}
+		check_order(os_set, expect_set);
+		check_extreme(min_set, expect_set, min_of, min_identity);
+		check_extreme(max_set, expect_set, max_of, max_identity);
+
+		/* 按中位数拆分，两侧各自的统计量都要正确，再拼接回来 */
+		Type pivot = *os_set.nth(os_set.size() / 2);
+		std::set<Type> expect_left(expect_set.begin(), expect_set.lower_bound(pivot));
+		std::set<Type> expect_right(expect_set.lower_bound(pivot), expect_set.end());
+		OsSet os_right;
+		MinSet min_right;
+		MaxSet max_right;
+		os_set.split(pivot, os_right);
+		min_set.split(pivot, min_right);
+		max_set.split(pivot, max_right);
+		check_order(os_set, expect_left);
+		check_order(os_right, expect_right);
+		check_extreme(min_set, expect_left, min_of, min_identity);
+		check_extreme(min_right, expect_right, min_of, min_identity);
+		check_extreme(max_set, expect_left, max_of, max_identity);
+		check_extreme(max_right, expect_right, max_of, max_identity);
+		os_set.join(std::move(os_right));
+		min_set.join(std::move(min_right));
+		max_set.join(std::move(max_right));
+		check_order(os_set, expect_set);
+		check_extreme(min_set, expect_set, min_of, min_identity);
+		check_extreme(max_set, expect_set, max_of, max_identity);
+
+		/* map按mapped值聚合，modify与insert_or_assign修改值后聚合值随之更新 */
+		CheckedRbTree<rbt::map<Type, Type, std::less<Type>, fpoo::CompactMemoryPool, false, rbt::MaxMonoid<Type, rbt::SelectMapped>>> max_map;
+		std::map<Type, Type> expect_map;
+		for (size_t i = 0; i < 20000; i++) {
+			Type key = data[i] % 50000;
+			Type value = RandInt() % 100000;
+			int op = RandInt() % 3;
+			if (op == 0) {
+				max_map.insert_or_assign(key, value);
+				expect_map.insert_or_assign(key, value);
+			}
+			else if (op == 1) {
+				auto iter = max_map.lower_bound(key);
+				if (iter != max_map.end()) {
+					max_map.modify(iter, [&](auto& element) { element.second = value; });
+					expect_map[iter->first] = value;
+				}
+			}
+			else if (max_map.erase(key) != expect_map.erase(key)) {
+				printf("???");
+			}
+		}
+		if (!max_map.VerifyTree() || !std::equal(max_map.begin(), max_map.end(), expect_map.begin(), expect_map.end())) {
+			printf("???");
+		}
+		for (Type lo = 0; lo < 50000; lo += 499) {
+			Type hi = lo + 1000;
+			Type brute = max_identity;
+			for (auto iter = expect_map.lower_bound(lo); iter != expect_map.end() && iter->first < hi; ++iter) {
+				brute = std::max(brute, iter->second);
+			}
+			if (max_map.reduce(lo, hi) != brute) {
+				printf("???");
+			}
+		}
+	}
+
+
+	{
+		/* 默认traits(无子树大小)与同一arena上的树做split/join，拆分点覆盖两端之外与任意位置 */
+		std::cout << "rbt::set::split/join(verify)" << std::endl;
+		using PlainSet = CheckedRbTree<rbt::set<Type>>;
+		using ArenaSet = CheckedRbTree<rbt::set<Type, std::less<Type>, rbt::ArenaPool>>;
+		ArenaSet::arena_type arena;
+		std::set<Type> expect_set(data.begin(), data.begin() + 20000);
+		PlainSet plain_set(expect_set.begin(), expect_set.end());
+		ArenaSet arena_set(arena);
+		arena_set.insert_sorted(expect_set.begin(), expect_set.end());
+		auto same = [](auto& tree, auto first, auto last) {
+			return tree.VerifyTree() && tree.size() == static_cast<decltype(tree.size())>(std::distance(first, last)) &&
+				std::equal(tree.begin(), tree.end(), first, last) &&
+				(tree.empty() || (*tree.begin() == *first && *tree.rbegin() == *std::prev(last)));
+		};
+		auto start_time = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < 200; i++) {
+			Type pivot = i == 0 ? -1 : i == 1 ? count : data[i * 7919 % 20000] + static_cast<Type>(i % 2);
+			auto middle = expect_set.lower_bound(pivot);
+			PlainSet plain_right;
+			ArenaSet arena_right(arena);
+			arena_right.insert(-5);
+			plain_set.split(pivot, plain_right);
+			arena_set.split(pivot, arena_right);
+			if (!same(plain_set, expect_set.begin(), middle) || !same(plain_right, middle, expect_set.end()) ||
+				!same(arena_set, expect_set.begin(), middle) || !same(arena_right, middle, expect_set.end())) {
+				printf("???");
+			}
+			/* 交替使用带pivot与不带pivot的join */
+			if (i % 2 == 0 || plain_right.empty()) {
+				plain_set.join(std::move(plain_right));
+				arena_set.join(std::move(arena_right));
+			}
+			else {
+				Type right_min = plain_right.pop_min();
+				arena_right.pop_min();
+				plain_set.join(right_min, std::move(plain_right));
+				arena_set.join(right_min, std::move(arena_right));
+			}
+			if (!same(plain_set, expect_set.begin(), expect_set.end()) || !same(arena_set, expect_set.begin(), expect_set.end()) ||
+				!plain_right.empty() || !arena_right.empty()) {
+				printf("???");
+			}
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+	}
+
+
+	{
+		/* 集合运算与std::set_*对照，覆盖两侧大小悬殊(两个方向)、空集与自身作为操作数 */
+		std::cout << "rbt::set::set_union/set_intersection/set_difference(verify)" << std::endl;
+		using CheckedSet = CheckedRbTree<rbt::set<Type>>;
+		auto make = [&](size_t first, size_t last, size_t step) {
+			std::set<Type> result;
+			for (size_t i = first; i < last; i += step) {
+				result.insert(data[i]);
+			}
+			return result;
+		};
+		std::vector<std::set<Type>> operands{
+			make(0, 0, 1),
+			make(0, 20, 1),
+			make(0, 500, 1),
+			make(0, 200000, 2),
+			make(1, 200000, 3),
+			make(0, 300000, 1),
+		};
+		auto start_time = std::chrono::high_resolution_clock::now();
+		for (auto& expect_a : operands) {
+			for (auto& expect_b : operands) {
+				CheckedSet rbt_b(expect_b.begin(), expect_b.end());
+				std::vector<Type> expect_union, expect_intersection, expect_difference;
+				std::set_union(expect_a.begin(), expect_a.end(), expect_b.begin(), expect_b.end(), std::back_inserter(expect_union));
+				std::set_intersection(expect_a.begin(), expect_a.end(), expect_b.begin(), expect_b.end(), std::back_inserter(expect_intersection));
+				std::set_difference(expect_a.begin(), expect_a.end(), expect_b.begin(), expect_b.end(), std::back_inserter(expect_difference));
+				CheckedSet rbt_union(expect_a.begin(), expect_a.end());
+				CheckedSet rbt_intersection = rbt_union;
+				CheckedSet rbt_difference = rbt_union;
+				rbt_union.set_union(rbt_b);
+				rbt_intersection.set_intersection(rbt_b);
+				rbt_difference.set_difference(rbt_b);
+				if (!rbt_union.VerifyTree() || !std::equal(rbt_union.begin(), rbt_union.end(), expect_union.begin(), expect_union.end()) ||
+					!rbt_intersection.VerifyTree() || !std::equal(rbt_intersection.begin(), rbt_intersection.end(), expect_intersection.begin(), expect_intersection.end()) ||
+					!rbt_difference.VerifyTree() || !std::equal(rbt_difference.begin(), rbt_difference.end(), expect_difference.begin(), expect_difference.end()) ||
+					!std::equal(rbt_b.begin(), rbt_b.end(), expect_b.begin(), expect_b.end())) {
+					printf("???");
+				}
+			}
+			CheckedSet self_union(expect_a.begin(), expect_a.end());
+			CheckedSet self_intersection = self_union;
+			CheckedSet self_difference = self_union;
+			self_union.set_union(self_union);
+			self_intersection.set_intersection(self_intersection);
+			self_difference.set_difference(self_difference);
+			if (!self_union.VerifyTree() || !std::equal(self_union.begin(), self_union.end(), expect_a.begin(), expect_a.end()) ||
+				!self_intersection.VerifyTree() || !std::equal(self_intersection.begin(), self_intersection.end(), expect_a.begin(), expect_a.end()) ||
+				!self_difference.VerifyTree() || !self_difference.empty()) {
+				printf("???");
+			}
+		}
+
+		/* key相同时保留本树的元素 */
+		rbt::map<Type, Type> mine_map, other_map;
+		for (Type i = 0; i < 1000; i++) {
+			mine_map[i * 2] = 1;
+		}
+		for (Type i = 0; i < 10; i++) {
+			other_map[i * 3] = 2;
+		}
+		auto union_map = mine_map;
+		union_map.set_union(other_map);
+		auto reverse_map = other_map;
+		reverse_map.set_union(mine_map);
+		for (Type i = 0; i < 30; i++) {
+			Type expect = i % 2 == 0 ? 1 : i % 3 == 0 ? 2 : 0;
+			Type reverse_expect = i % 3 == 0 ? 2 : i % 2 == 0 ? 1 : 0;
+			if ((expect == 0 ? union_map.contains(i) : union_map.at(i) != expect) ||
+				(reverse_expect == 0 ? reverse_map.contains(i) : reverse_map.at(i) != reverse_expect)) {
+				printf("???");
+			}
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+	}
+
+
+	{
+		/* cursor连续移动只在第一步求出路径，之后与迭代器相同；重复key时也要按插入顺序逐个经过 */
+		std::cout << "rbt::set::cursor::scan" << std::endl;
+		rbt::set<Type> scan_set(data.begin(), data.end());
+		auto start_time = std::chrono::high_resolution_clock::now();
+		Type expect = 0;
+		for (rbt::set<Type>::cursor cur = scan_set.begin(); cur != rbt::set<Type>::cursor{ scan_set.end() }; ++cur, ++expect) {
+			if (*cur != expect) {
+				printf("???");
+			}
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+		std::cout << "time: " << duration.count() << "ms" << std::endl;
+		if (expect != count) {
+			printf("???");
+		}
+
+		rbt::multimap<Type, size_t> scan_multimap;
+		std::multimap<Type, size_t> expect_multimap;
+		for (size_t i = 0; i < 20000; i++) {
+			scan_multimap.emplace(data[i] % 16, i);
+			expect_multimap.emplace(data[i] % 16, i);
+		}
+		/* 从中间开始双向移动，中途插入使路径过期 */
+		rbt::multimap<Type, size_t>::cursor cur = scan_multimap.lower_bound(8);
+		auto expect_iter = expect_multimap.lower_bound(8);
+		for (size_t i = 0; i < 5000; i++) {
+			++cur;
+			++expect_iter;
+		}
+		scan_multimap.emplace(3, 0);
+		expect_multimap.emplace(3, 0);
+		auto copy = cur;
+		for (size_t i = 0; i < 8000; i++) {
+			--cur;
+			--expect_iter;
+		}
+		if (*cur != *expect_iter || *copy != *std::next(expect_iter, 8000) || *++copy != *std::next(expect_iter, 8001)) {
+			printf("???");
+		}
+		rbt::multimap<Type, size_t>::cursor last = scan_multimap.end();
+		if (*--last != *expect_multimap.rbegin()) {
+			printf("???");
+		}
+	}
+
+
+	{
+		/* 插入与pop_min/pop_max交替，每一步之后缓存的最值都要与std::set一致 */
+		CheckedRbTree<rbt::set<Type>> pop_set;
+		std::set<Type> expect_set;
+		CheckedRbTree<rbt::multimap<Type, size_t>> pop_multimap;
+		std::multimap<Type, size_t> expect_multimap;
+		for (size_t i = 0; i < 100000; i++) {
+			int op = RandInt() % 4;
+			if (op < 2 || expect_set.empty()) {
+				Type key = RandInt() % 5000;
+				pop_set.insert(key);
+				expect_set.insert(key);
+				pop_multimap.emplace(key % 100, i);
+				expect_multimap.emplace(key % 100, i);
+			}
+			else if (op == 2) {
+				if (pop_set.pop_min() != *expect_set.begin() || pop_multimap.pop_min() != *expect_multimap.begin()) {
+					printf("???");
+				}
+				expect_set.erase(expect_set.begin());
+				expect_multimap.erase(expect_multimap.begin());
+			}
+			else {
+				if (pop_set.pop_max() != *expect_set.rbegin() || pop_multimap.pop_max() != *expect_multimap.rbegin()) {
+					printf("???");
+				}
+				expect_set.erase(std::prev(expect_set.end()));
+				expect_multimap.erase(std::prev(expect_multimap.end()));
+			}
+			if (pop_set.empty() != expect_set.empty() ||
+				(!expect_set.empty() && (*pop_set.begin() != *expect_set.begin() || *pop_set.rbegin() != *expect_set.rbegin() ||
+					*std::prev(pop_set.end()) != *expect_set.rbegin() || *pop_multimap.begin() != *expect_multimap.begin() ||
+					*pop_multimap.rbegin() != *expect_multimap.rbegin()))) {
+				printf("???");
+			}
+			if (i % 1000 == 0 && (!pop_set.VerifyTree() || !pop_multimap.VerifyTree())) {
+				printf("???");
+			}
+		}
+		if (!std::equal(pop_set.begin(), pop_set.end(), expect_set.begin(), expect_set.end()) ||
+			!std::equal(pop_multimap.begin(), pop_multimap.end(), expect_multimap.begin(), expect_multimap.end())) {
+			printf("???");
+		}
+	}
+
+
 	//for (int64_t i = 0; i < count; i++) {
 	//	std::swap(data[i], data[RandInt() % count]);
 	//}